@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+
+/**
+ * @brief A minimal throughput benchmark harness.
+ *
+ * Benchmarks live next to the code they measure, guarded by `#ifdef BENCH`
+ * just like the doctest cases are guarded by `#ifdef TEST`. `make benchmark`
+ * builds the binary with `-DBENCH` and runs all registered cases.
+ */
+namespace Benchmark {
+typedef std::function<void()> benchmark_case;
+
+/// @brief register a benchmark case to be run by Benchmark::run_all
+/// @param name a human readable name for the case
+/// @param function the benchmark body
+/// @return a dummy value, to allow registration in a static initializer
+int register_case(const std::string &name, benchmark_case function);
+
+/// @brief run every registered benchmark case, in registration order
+/// @return the process exit code
+int run_all();
+
+/// @brief repeatedly call \p function , which processes \p bytes bytes per
+/// call, and print the achieved throughput in GB/s.
+/// @param name the label to print
+/// @param bytes the number of bytes processed per call to \p function
+/// @param function the operation to measure
+/// @return the throughput in bytes per second
+double throughput(const std::string &name, std::size_t bytes,
+                  const std::function<void()> &function);
+} // namespace Benchmark
+
+#define BENCHMARK_CONCAT_IMPL(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT_IMPL(a, b)
+
+/// @brief define and register a benchmark case, used like doctest's TEST_CASE
+#define BENCHMARK_CASE(name)                                                   \
+  static void BENCHMARK_CONCAT(benchmark_case_, __LINE__)();                   \
+  [[maybe_unused]] static const int BENCHMARK_CONCAT(benchmark_registration_, \
+                                                     __LINE__) =               \
+      Benchmark::register_case(name,                                           \
+                               BENCHMARK_CONCAT(benchmark_case_, __LINE__));   \
+  static void BENCHMARK_CONCAT(benchmark_case_, __LINE__)()
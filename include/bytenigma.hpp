@@ -1,8 +1,16 @@
 #pragma once
 #include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <span>
 #include <vector>
 
+#include "bytenigma/engine.hpp"
+#include "parallel.hpp"
+
 namespace Bytenigma {
+
 /**
  *  @brief An enigma-like encryption which works by chaining a variable number
  * of to encrypt a sequence of bytes.
@@ -28,7 +36,24 @@ class Bytenigma {
 public:
   /// @brief create a new bytenigma machine
   /// @param rotors the initial rotor configuration
-  Bytenigma(const std::vector<std::vector<std::uint8_t>> &rotors);
+  /// @param positions the initial turn offset of each rotor, as returned by
+  /// positions() . This allows resuming a stream. If empty, all rotors start
+  /// at offset 0.
+  /// @throws std::invalid_argument if \p positions is neither empty nor has
+  /// one entry per rotor
+  Bytenigma(const std::vector<std::vector<std::uint8_t>> &rotors,
+            const std::vector<std::uint8_t> &positions = {});
+
+  /// @brief create a new bytenigma machine for an already prepared rotor
+  /// context. Only the rotor positions are allocated, so this is cheap enough
+  /// to do once per message.
+  /// @param context the shared rotor tables, see RotorTables::cached()
+  /// @param positions the initial turn offset of each rotor. If empty, all
+  /// rotors start at offset 0.
+  /// @throws std::invalid_argument if \p positions is neither empty nor has
+  /// one entry per rotor
+  Bytenigma(std::shared_ptr<const RotorTables> context,
+            const std::vector<std::uint8_t> &positions = {});
 
   /// @brief input a single byte into the machine, process it (modifying the
   /// internal state), and return the resulting byte.
@@ -37,12 +62,53 @@ public:
   std::uint8_t process_byte(std::uint8_t input);
 
   /// @brief input multiple bytes after another into the bytenigma machine and
-  /// process all of them.
+  /// process all of them. This uses the Engine specialized for the rotor count
+  /// of this machine. Large inputs are split into chunks which are encrypted
+  /// on \p threads threads; the result is the same as for a single thread.
   /// @param input the sequence of input bytes to process. \p input [0] is
   /// processed first.
+  /// @param threads the number of worker threads
   /// @return the bytes, in the same order as in the input, encrypted.
   std::vector<std::uint8_t>
-  process_bytes(const std::vector<std::uint8_t> &input);
+  process_bytes(const std::vector<std::uint8_t> &input,
+                std::size_t threads = Parallel::default_threads());
+
+  /// @brief like process_bytes(const std::vector<std::uint8_t> &, std::size_t)
+  /// , but writing into a caller-provided buffer
+  /// @param input the sequence of input bytes to process
+  /// @param output the buffer for the encrypted bytes, same size as \p input
+  /// @param threads the number of worker threads
+  void process_bytes(std::span<const std::uint8_t> input,
+                     std::span<std::uint8_t> output,
+                     std::size_t threads = Parallel::default_threads());
+
+  /// @brief encrypt everything that can be read from \p input and write it to
+  /// \p output , one Stream::CHUNK_SIZE chunk at a time. The memory use does
+  /// not depend on the length of the stream.
+  /// @param input the stream to read the plaintext from
+  /// @param output the stream to write the ciphertext to
+  /// @return the number of bytes processed
+  /// @throws std::runtime_error if reading or writing fails
+  std::uint64_t process_stream(std::istream &input, std::ostream &output);
+
+  /// @brief the current turn offset of each rotor. Passing these to the
+  /// constructor continues the stream where this machine left off.
+  const std::vector<std::uint8_t> &positions() const {
+    return m_rotor_positions;
+  }
+
+  /// @brief calculate the rotor positions after \p offset bytes have been
+  /// processed, counted from the initial rotor configuration. This takes
+  /// `O(rotors)` time, regardless of \p offset .
+  /// @param offset the number of bytes processed since construction
+  /// @return the turn offset for each rotor at that point of the stream
+  std::vector<std::uint8_t> state_at(std::uint64_t offset) const;
+
+  /// @brief move the machine to the given stream \p offset , so that the next
+  /// processed byte is encrypted as the byte at \p offset of the stream.
+  /// Seeking backwards is allowed.
+  /// @param offset the number of bytes processed since construction
+  void seek(std::uint64_t offset);
 
 // Make the member functions public for test builds
 #ifndef TEST
@@ -67,16 +133,12 @@ private:
   /// @param index the index of the rotor to turn.
   void turn_rotor(const std::size_t &index);
 
-  /// @brief Ensure the `m_inv_rotors` field is populated according to the
-  /// current rotors
-  void calculate_inverse_rotors();
-
-  /// @brief the rotor positions of the machine
-  const std::vector<std::vector<std::uint8_t>> m_rotors;
+  /// @brief the shared, immutable rotor tables of this machine
+  const std::shared_ptr<const RotorTables> m_context;
 
-  /// @brief a list of inverse mappings for each rotor. m_inv_rotors[0] still
-  /// gives the first rotor and m_rotors[m_inv_rotors[x]] == x.
-  std::vector<std::vector<std::uint8_t>> m_inv_rotors;
+  /// @brief the turn offset for each rotor at construction, i.e. at stream
+  /// offset 0
+  const std::vector<std::uint8_t> m_initial_positions;
 
   /// @brief the turn offset for each rotor
   std::vector<std::uint8_t> m_rotor_positions;
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <span>
+
+#include "bytenigma/engine.hpp"
+
+namespace Bytenigma {
+
+/// @brief the number of bytes a message must have per stale composed level for
+/// process_batch() to rebuild those levels instead of using the Engine
+constexpr std::size_t BATCH_BYTES_PER_LEVEL = 16;
+
+/// @brief one independent message of a batch
+struct Message {
+  /// @brief the rotors of the machine for this message
+  const RotorTables *tables;
+  /// @brief the turn offset of each rotor, updated in place
+  std::span<std::uint8_t> positions;
+  /// @brief the bytes to encrypt
+  std::span<const std::uint8_t> input;
+  /// @brief the buffer for the encrypted bytes, same size as `input`
+  std::span<std::uint8_t> output;
+};
+
+/// @brief encrypt many independent messages, each with its own rotors and
+/// positions, with the same result as calling process() for each of them.
+///
+/// For short messages, process() spends most of its time setting up a
+/// ComposedEngine, or falls back to the Engine, which needs two lookups per
+/// rotor and byte. Here the messages are sorted by rotors and positions, and
+/// one ComposedEngine per rotor set is moved from message to message with
+/// ComposedEngine::reset(). Messages which share the positions of rotors
+/// `1..n-1` (such as many messages starting at the same state) then share the
+/// composed table, and every message is encrypted by the SIMD::Kernel. A
+/// message only falls back to the Engine if it is too short to pay for
+/// rebuilding the levels which differ, see BATCH_BYTES_PER_LEVEL.
+/// @param messages the messages to encrypt
+void process_batch(std::span<const Message> messages);
+
+} // namespace Bytenigma
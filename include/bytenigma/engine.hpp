@@ -0,0 +1,289 @@
+#pragma once
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "bytenigma/simd.hpp"
+
+namespace Bytenigma {
+
+/// @brief the number of entries in a single rotor
+constexpr std::size_t ROTOR_SIZE = 256;
+
+/// @brief the largest rotor count for which a fully unrolled Engine is
+/// instantiated. Machines with more rotors use the dynamic engine.
+constexpr std::size_t MAX_UNROLLED_ROTORS = 8;
+
+/// @brief template argument selecting an Engine which reads the rotor count
+/// at runtime
+constexpr std::size_t DYNAMIC_ROTOR_COUNT = 0;
+
+/// @brief a single rotor mapping, aligned to a cache line so that a rotor
+/// never straddles more cache lines than necessary.
+struct alignas(64) Rotor {
+  std::array<std::uint8_t, ROTOR_SIZE> map;
+};
+
+/**
+ * @brief The forward and inverse mappings of all rotors of a machine, stored
+ * in one contiguous, aligned `[2n][256]` block.
+ *
+ * Rows `0..n-1` hold the forward rotors, rows `n..2n-1` hold the inverse
+ * rotors. Every rotor is validated to be a permutation of all 256 byte values
+ * on construction, so that lookups never need bounds checks or a modulo.
+ *
+ * The tables never change after construction, so one instance can be shared by
+ * any number of machines and threads. Use cached() to reuse the tables of a
+ * rotor set that was seen before.
+ */
+class RotorTables {
+public:
+  /// @brief build the flat tables for a given rotor configuration
+  /// @param rotors the rotors, each a permutation of all 256 byte values
+  /// @throws std::invalid_argument if there are no rotors or if any rotor is
+  /// not a permutation of all byte values
+  RotorTables(const std::vector<std::vector<std::uint8_t>> &rotors);
+
+  /// @brief get the tables for \p rotors from a process-wide cache, building
+  /// them only if this rotor set has not been seen recently. Safe to call from
+  /// multiple threads.
+  /// @param rotors the rotors, each a permutation of all 256 byte values
+  /// @return the shared tables
+  /// @throws std::invalid_argument if the rotors are invalid, see RotorTables()
+  static std::shared_ptr<const RotorTables>
+  cached(const std::vector<std::vector<std::uint8_t>> &rotors);
+
+  /// @brief the number of rotors
+  std::size_t size() const { return m_tables.size() / 2; }
+
+  /// @brief the forward mapping of the rotor at \p index
+  const std::uint8_t *forward(std::size_t index) const {
+    return m_tables[index].map.data();
+  }
+
+  /// @brief the inverse mapping of the rotor at \p index , i.e.
+  /// `inverse(i)[forward(i)[x]] == x`
+  const std::uint8_t *inverse(std::size_t index) const {
+    return m_tables[this->size() + index].map.data();
+  }
+
+  /// @brief the position of the rotor at \p index at which turning it also
+  /// turns the next rotor, i.e. the position of its 0
+  std::uint8_t carry_position(std::size_t index) const {
+    return m_carry_positions[index];
+  }
+
+  /// @brief check whether these are the tables of \p rotors
+  bool matches(const std::vector<std::vector<std::uint8_t>> &rotors) const;
+
+private:
+  std::vector<Rotor> m_tables;
+  std::vector<std::uint8_t> m_carry_positions;
+};
+
+/// @brief the maximum number of rotor sets kept by RotorTables::cached()
+constexpr std::size_t ROTOR_CACHE_SIZE = 64;
+
+/**
+ * @brief A bytenigma encryption loop specialized for a fixed number of
+ * rotors.
+ *
+ * For `N > 0` the rotor count is a compile-time constant, so the forward pass,
+ * the backward pass and the rotor turning loops are unrolled completely and
+ * the rotor positions are held in registers. `N == DYNAMIC_ROTOR_COUNT` reads
+ * the rotor count from the tables instead.
+ * @tparam N the number of rotors, or DYNAMIC_ROTOR_COUNT
+ */
+template <std::size_t N> class Engine {
+  using Positions = std::conditional_t<N == DYNAMIC_ROTOR_COUNT,
+                                       std::vector<std::uint8_t>,
+                                       std::array<std::uint8_t, N>>;
+  using Pointers = std::conditional_t<N == DYNAMIC_ROTOR_COUNT,
+                                      std::vector<const std::uint8_t *>,
+                                      std::array<const std::uint8_t *, N>>;
+
+public:
+  /// @brief encrypt \p input into \p output , advancing the rotor \p
+  /// positions by one step per byte.
+  /// @param tables the rotors of the machine
+  /// @param positions the turn offset of each rotor, updated in place
+  /// @param input the bytes to encrypt
+  /// @param output the buffer for the encrypted bytes, same size as \p input
+  static void process(const RotorTables &tables,
+                      std::span<std::uint8_t> positions,
+                      std::span<const std::uint8_t> input,
+                      std::span<std::uint8_t> output) {
+    const std::size_t count = Engine::rotor_count(tables);
+    assert(positions.size() == count && "Rotor count mismatch");
+    assert(input.size() == output.size() && "Output must match input size");
+
+    // Work on local copies so that the compiler can keep them in registers
+    // instead of reloading them after every store to `output`.
+    Positions pos{};
+    Pointers forward{}, inverse{};
+    if constexpr (N == DYNAMIC_ROTOR_COUNT) {
+      pos.resize(count);
+      forward.resize(count);
+      inverse.resize(count);
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+      pos[i] = positions[i];
+      forward[i] = tables.forward(i);
+      inverse[i] = tables.inverse(i);
+    }
+
+    for (std::size_t byte = 0; byte < input.size(); ++byte) {
+      std::uint8_t x = input[byte];
+      for (std::size_t i = 0; i < count; ++i) {
+        x = forward[i][static_cast<std::uint8_t>(x + pos[i])];
+      }
+      x = ~x;
+      for (std::size_t i = count; i-- > 0;) {
+        x = inverse[i][x] - pos[i];
+      }
+      output[byte] = x;
+
+      // Turn rotor 0 and carry into the next rotor for as long as the rotor
+      // that was just turned had a 0 at its top-most position.
+      for (std::size_t i = 0; i < count; ++i) {
+        if (forward[i][pos[i]++] != 0)
+          break;
+      }
+    }
+
+    for (std::size_t i = 0; i < count; ++i) {
+      positions[i] = pos[i];
+    }
+  }
+
+private:
+  static std::size_t rotor_count(const RotorTables &tables) {
+    if constexpr (N == DYNAMIC_ROTOR_COUNT) {
+      return tables.size();
+    } else {
+      assert(tables.size() == N && "Rotor count mismatch");
+      return N;
+    }
+  }
+};
+
+/**
+ * @brief A bytenigma encryption loop which collapses all rotors but the first
+ * into a single composed permutation.
+ *
+ * Rotors `1..n-1` only turn when rotor 0 carries, which happens exactly once
+ * every 256 bytes. In between, the forward pass through rotors `1..n-1`, the
+ * complement and the backward pass through rotors `n-1..1` form one fixed
+ * byte permutation. This engine keeps that permutation as a 256-entry table,
+ * so encrypting a byte costs two lookups in rotor 0 plus one table lookup,
+ * independent of the number of rotors.
+ *
+ * The composed table is built hierarchically: `m_composed[k]` covers rotors
+ * `k..n-1`, so a carry which only turns rotor 1 (the common case) rebuilds a
+ * single level. Each run between two carries is handed to a vectorized
+ * SIMD::Kernel.
+ */
+class ComposedEngine {
+public:
+  /// @brief prepare the composed tables for the given machine state
+  /// @param tables the rotors of the machine
+  /// @param positions the turn offset of each rotor
+  /// @param kernel the kernel for the runs between carries
+  ComposedEngine(const RotorTables &tables,
+                 std::span<const std::uint8_t> positions,
+                 const SIMD::Kernel &kernel = SIMD::best_kernel());
+
+  /// @brief encrypt \p input into \p output , advancing the rotor positions
+  /// by one step per byte.
+  /// @param input the bytes to encrypt
+  /// @param output the buffer for the encrypted bytes, same size as \p input
+  void process(std::span<const std::uint8_t> input,
+               std::span<std::uint8_t> output);
+
+  /// @brief the rotors this engine was built for
+  const RotorTables &tables() const { return m_tables; }
+
+  /// @brief the current turn offset of each rotor
+  std::span<const std::uint8_t> positions() const { return m_positions; }
+
+  /// @brief the number of composed levels which reset() would rebuild for \p
+  /// positions , i.e. the index of the outermost rotor whose position differs
+  /// from the current one, or 0 if only rotor 0 differs
+  /// @param positions the turn offset of each rotor
+  std::size_t stale_levels(std::span<const std::uint8_t> positions) const;
+
+  /// @brief move the engine to new rotor \p positions , e.g. to continue with
+  /// another message under the same rotors. Only the levels counted by
+  /// stale_levels() are rebuilt.
+  /// @param positions the turn offset of each rotor
+  void reset(std::span<const std::uint8_t> positions);
+
+private:
+  /// @brief rebuild the composed tables for rotors `1..=top`, from the
+  /// outermost level inwards
+  void rebuild(std::size_t top);
+
+  const RotorTables &m_tables;
+  const SIMD::Kernel m_kernel;
+  std::vector<std::uint8_t> m_positions;
+
+  /// @brief the position of rotor 0 at which it carries into rotor 1
+  const std::uint8_t m_carry_position;
+
+  /// @brief `m_composed[k]` maps a byte entering rotor `k` to the byte leaving
+  /// rotor `k` on the backward pass. `m_composed[n]` is the complement. Only
+  /// `m_composed[1]` is used per byte.
+  std::vector<Rotor> m_composed;
+};
+
+/// @brief the smallest rotor count for which process() prefers the
+/// ComposedEngine over the unrolled Engine
+constexpr std::size_t COMPOSED_MIN_ROTORS = 2;
+
+/// @brief encrypt \p input into \p output using the fastest engine for the
+/// rotor count of \p tables : the ComposedEngine for deep rotor stacks, the
+/// Engine specialized for the rotor count otherwise (or the dynamic Engine, if
+/// there is none).
+/// @param tables the rotors of the machine
+/// @param positions the turn offset of each rotor, updated in place
+/// @param input the bytes to encrypt
+/// @param output the buffer for the encrypted bytes, same size as \p input
+void process(const RotorTables &tables, std::span<std::uint8_t> positions,
+             std::span<const std::uint8_t> input,
+             std::span<std::uint8_t> output);
+
+/// @brief turn the rotors as if \p steps bytes had been processed, without
+/// processing them.
+///
+/// The rotors behave like an odometer: rotor `i` carries into rotor `i+1`
+/// exactly when it turns away from the position holding its 0. So the number
+/// of carries out of rotor `i` only depends on its start position and how
+/// often it is turned, which makes this `O(n)` instead of `O(steps)`.
+/// @param tables the rotors of the machine
+/// @param positions the turn offset of each rotor, updated in place
+/// @param steps the number of bytes to skip
+void advance(const RotorTables &tables, std::span<std::uint8_t> positions,
+             std::uint64_t steps);
+
+/// @brief the smallest input for which process_parallel() splits the work
+/// across threads. Below this, starting threads costs more than it saves.
+constexpr std::size_t PARALLEL_MIN_BYTES = 1 << 20;
+
+/// @brief encrypt \p input into \p output like process(), but split it into
+/// chunks which are encrypted concurrently. The start state of each chunk is
+/// computed with advance(), so the output is identical to process().
+/// @param tables the rotors of the machine
+/// @param positions the turn offset of each rotor, updated in place
+/// @param input the bytes to encrypt
+/// @param output the buffer for the encrypted bytes, same size as \p input
+/// @param threads the number of worker threads
+void process_parallel(const RotorTables &tables,
+                      std::span<std::uint8_t> positions,
+                      std::span<const std::uint8_t> input,
+                      std::span<std::uint8_t> output, std::size_t threads);
+
+} // namespace Bytenigma
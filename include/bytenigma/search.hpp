@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "bytenigma/engine.hpp"
+#include "parallel.hpp"
+
+namespace Bytenigma {
+
+/// @brief the largest rotor count accepted by find_positions(). The search
+/// space grows by a factor of 256 per rotor.
+constexpr std::size_t MAX_SEARCH_ROTORS = 4;
+
+/// @brief find every set of start positions under which \p plaintext encrypts
+/// to \p ciphertext .
+///
+/// The rotors `1..n-1` are enumerated like an odometer, keeping their composed
+/// table up to date with one SIMD::Kernel::compose per step. For each of those
+/// states, all 256 positions of rotor 0 are tried on the first byte at once:
+/// a run over 256 copies of `plaintext[0]` starting at position 0 yields, in
+/// lane `j`, the first ciphertext byte for rotor 0 at position `j`. Only the
+/// few candidates which match are checked against the remaining bytes, with
+/// Bytenigma::process_byte and rejected on the first mismatch.
+/// @param context the rotor tables of the machine
+/// @param plaintext the known plaintext
+/// @param ciphertext the known ciphertext, same size as \p plaintext
+/// @param threads the number of worker threads
+/// @return all matching start positions, in lexicographic order
+/// @throws std::invalid_argument if there are more than MAX_SEARCH_ROTORS
+/// rotors, or if the plaintext is empty or not as long as the ciphertext
+std::vector<std::vector<std::uint8_t>>
+find_positions(const std::shared_ptr<const RotorTables> &context,
+               std::span<const std::uint8_t> plaintext,
+               std::span<const std::uint8_t> ciphertext,
+               std::size_t threads = Parallel::default_threads());
+
+} // namespace Bytenigma
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * @brief Vectorized kernels for a single run of the ComposedEngine.
+ *
+ * Within one run, byte `j` is encrypted as
+ * `inverse[composed[forward[in[j] + p + j]]] - (p + j)` where `p` is the
+ * position of rotor 0 at the start of the run. The three tables are fixed for
+ * the whole run and the position only differs by the lane index, so the run
+ * is a chain of 256-entry byte permutations applied to many bytes at once.
+ *
+ * Rebuilding a level of the composed table after a carry has the same shape,
+ * `inverse[outer[forward[y + p]]] - p` for all 256 values of `y`, so every
+ * kernel also provides a vectorized compose step.
+ *
+ * The kernels differ only in how they look up 256-entry tables:
+ *  - SSSE3: 16 `pshufb` lookups into 16-byte sub-tables, 16 bytes per step
+ *  - AVX2: the same with 256-bit registers, 32 bytes per step
+ *  - AVX-512 VBMI: two `vpermi2b` lookups into 128-byte halves, 64 bytes per
+ * step
+ *
+ * The kernel is chosen at runtime from the features reported by CPU::features,
+ * with a scalar fallback for hosts without any of the above.
+ */
+namespace Bytenigma::SIMD {
+
+/// @brief the three 256-entry tables which are fixed during one run
+struct RunTables {
+  const std::uint8_t *forward;
+  const std::uint8_t *composed;
+  const std::uint8_t *inverse;
+};
+
+/// @brief encrypt \p input into \p output for one run starting at rotor 0
+/// position \p position . \p input and \p output have the same size.
+typedef void (*run_kernel)(const RunTables &tables,
+                           std::span<const std::uint8_t> input,
+                           std::span<std::uint8_t> output,
+                           std::uint8_t position);
+
+/// @brief fill \p output with `inverse[composed[forward[y + position]]] -
+/// position` for every byte value `y`.
+typedef void (*compose_kernel)(const RunTables &tables, std::uint8_t position,
+                               std::span<std::uint8_t, 256> output);
+
+/// @brief the kernels for one instruction set, together with a human readable
+/// name
+struct Kernel {
+  const char *name;
+  run_kernel run;
+  compose_kernel compose;
+};
+
+void run_scalar(const RunTables &tables, std::span<const std::uint8_t> input,
+                std::span<std::uint8_t> output, std::uint8_t position);
+void run_ssse3(const RunTables &tables, std::span<const std::uint8_t> input,
+               std::span<std::uint8_t> output, std::uint8_t position);
+void run_avx2(const RunTables &tables, std::span<const std::uint8_t> input,
+              std::span<std::uint8_t> output, std::uint8_t position);
+void run_avx512vbmi(const RunTables &tables,
+                    std::span<const std::uint8_t> input,
+                    std::span<std::uint8_t> output, std::uint8_t position);
+
+void compose_scalar(const RunTables &tables, std::uint8_t position,
+                    std::span<std::uint8_t, 256> output);
+void compose_ssse3(const RunTables &tables, std::uint8_t position,
+                   std::span<std::uint8_t, 256> output);
+void compose_avx2(const RunTables &tables, std::uint8_t position,
+                  std::span<std::uint8_t, 256> output);
+void compose_avx512vbmi(const RunTables &tables, std::uint8_t position,
+                        std::span<std::uint8_t, 256> output);
+
+/// @brief all kernels which the host CPU can execute, fastest first. The
+/// scalar kernel is always supported. The SSSE3 kernel is listed after it, as
+/// it is slower than plain loads and only useful for comparison.
+/// @return the supported kernels
+std::vector<Kernel> supported_kernels();
+
+/// @brief the fastest kernel which the host CPU can execute
+/// @return the kernel, determined once and cached afterwards
+const Kernel &best_kernel();
+
+} // namespace Bytenigma::SIMD
@@ -0,0 +1,35 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <vector>
+
+/**
+ * @brief Helpers shared by the Bytenigma tests and benchmarks.
+ *
+ * Only included from `#ifdef TEST` and `#ifdef BENCH` blocks.
+ */
+namespace Bytenigma::Testing {
+
+/// @brief generate \p count random rotors, each a shuffled permutation of the
+/// 256 byte values, drawing from \p gen
+inline std::vector<std::vector<std::uint8_t>> random_rotors(std::size_t count,
+                                                            std::mt19937 &gen) {
+  std::vector<std::vector<std::uint8_t>> rotors(count,
+                                                std::vector<std::uint8_t>(256));
+  for (std::vector<std::uint8_t> &rotor : rotors) {
+    std::iota(rotor.begin(), rotor.end(), 0);
+    std::shuffle(rotor.begin(), rotor.end(), gen);
+  }
+  return rotors;
+}
+
+/// @brief generate \p count random rotors from a fixed seed
+inline std::vector<std::vector<std::uint8_t>> random_rotors(std::size_t count,
+                                                            std::uint32_t seed) {
+  std::mt19937 gen(seed);
+  return random_rotors(count, gen);
+}
+
+} // namespace Bytenigma::Testing
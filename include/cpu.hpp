@@ -0,0 +1,39 @@
+#pragma once
+
+/**
+ * @brief Runtime detection of the instruction set extensions of the host CPU.
+ *
+ * Kernels which use instructions beyond the baseline set in the Makefile are
+ * compiled with a function-level `target` attribute and only called after
+ * checking the matching flag here, so a single binary runs on every host.
+ */
+/// @brief compile a function for the given instruction set extensions, e.g.
+/// `CPU_TARGET("avx2") void kernel();`
+#define CPU_TARGET(features) __attribute__((target(features)))
+
+/// @brief force a helper to be inlined into its kernel (which must have the
+/// same CPU_TARGET), so that its vectors stay in registers
+#define CPU_INLINE __attribute__((always_inline)) static inline
+
+namespace CPU {
+
+/// @brief the instruction set extensions which are both supported by the CPU
+/// and enabled by the operating system
+struct Features {
+  bool ssse3;
+  bool sse41;
+  bool pclmul;
+  bool aesni;
+  bool avx2;
+  bool avx512f;
+  bool avx512bw;
+  bool avx512vbmi;
+  bool vpclmulqdq;
+};
+
+/// @brief query the features of the host CPU. The result is computed once
+/// using `cpuid` and `xgetbv` and cached afterwards.
+/// @return the supported features
+const Features &features();
+
+} // namespace CPU
@@ -0,0 +1,405 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <emmintrin.h>
+#include <iostream>
+#include <utility>
+#include <smmintrin.h>
+#include <wmmintrin.h>
+
+#include "cpu.hpp"
+#include "gcm/backend.hpp"
+#include "random.hpp"
+
+/**
+ * @brief Binary fields GF(2^N) with a compile-time reduction polynomial.
+ *
+ * An element is stored in N / 64 little endian 64-bit limbs. The reduction
+ * polynomial is `x^N + TAIL`, where the low degree TAIL is given as a bit
+ * mask, e.g. `0x87` for `x^128 + x^7 + x^2 + x + 1`.
+ *
+ * Products are computed limb by limb with carry-less multiplications. The
+ * upper half of the wide product is then folded back, since
+ * `x^N = TAIL (mod x^N + TAIL)`. The fold is chosen at compile time:
+ * trinomial tails are folded with one shift/xor per term, all others with one
+ * carry-less multiplication per limb.
+ *
+ * The bit-reflected GCM field GF(2^128) is the instantiation
+ * `Polynomial<128, 0x87, BitOrder::Reflected>` and uses GCM::Backend, so it
+ * is exactly as fast as GCM::Polynomial.
+ *
+ * All arithmetic is constexpr. During constant evaluation the intrinsics are
+ * replaced by portable loops (and reflected elements are bit-reversed into the
+ * natural order), so constants and lookup tables can be computed at compile
+ * time and placed in read-only data. The same loops are used at runtime on
+ * hosts without PCLMULQDQ.
+ */
+namespace Galois {
+
+/// @brief the order of the coefficients in the limbs
+enum class BitOrder {
+  /// coefficient i is bit i
+  Natural,
+  /// coefficient i is bit N - 1 - i, as in GCM
+  Reflected,
+};
+
+/// @brief how the upper half of a wide product is folded back
+enum class Reduction {
+  /// shift and xor once per set bit of the tail
+  ShiftXor,
+  /// one carry-less multiplication by the tail per limb
+  Clmul,
+};
+
+/// Tails with at most this many terms are cheaper to fold with shifts. A
+/// single carry-less multiplication per limb already beats the four shifts of
+/// a pentanomial such as the GCM polynomial.
+constexpr int SHIFT_XOR_MAX_TERMS = 2;
+
+/// @brief the cheaper Reduction for a reduction polynomial `x^N + tail`
+constexpr Reduction default_reduction(std::uint64_t tail) {
+  return std::popcount(tail) <= SHIFT_XOR_MAX_TERMS ? Reduction::ShiftXor
+                                                    : Reduction::Clmul;
+}
+
+/// @brief carry-less product of two 64-bit limbs with a portable shift/xor
+/// loop over the set bits of \p b, which also works in constant evaluation
+/// @return the low and high limb of the 128-bit product
+constexpr std::array<std::uint64_t, 2> clmul64_portable(std::uint64_t a,
+                                                        std::uint64_t b) {
+  std::uint64_t low = 0, high = 0;
+  for (; b != 0; b &= b - 1) {
+    int i = std::countr_zero(b);
+    low ^= a << i;
+    high ^= i == 0 ? 0 : a >> (64 - i);
+  }
+  return {low, high};
+}
+
+/// @brief carry-less square of a 64-bit limb, which spreads its bits out to
+/// the even positions
+/// @return the low and high limb of the 128-bit square
+constexpr std::array<std::uint64_t, 2> clsquare64_portable(std::uint64_t a) {
+  auto spread = [](std::uint64_t x) {
+    x = (x | x << 16) & 0x0000ffff0000ffff;
+    x = (x | x << 8) & 0x00ff00ff00ff00ff;
+    x = (x | x << 4) & 0x0f0f0f0f0f0f0f0f;
+    x = (x | x << 2) & 0x3333333333333333;
+    x = (x | x << 1) & 0x5555555555555555;
+    return x;
+  };
+  return {spread(a & 0xffffffff), spread(a >> 32)};
+}
+
+/// @brief clmul64_portable() using PCLMULQDQ
+CPU_TARGET("pclmul") inline std::array<std::uint64_t, 2>
+clmul64_pclmul(std::uint64_t a, std::uint64_t b) {
+  __m128i product = _mm_clmulepi64_si128(
+      _mm_cvtsi64_si128(static_cast<long long>(a)),
+      _mm_cvtsi64_si128(static_cast<long long>(b)), 0x00);
+  return {static_cast<std::uint64_t>(_mm_cvtsi128_si64(product)),
+          static_cast<std::uint64_t>(_mm_extract_epi64(product, 1))};
+}
+
+/// @brief reverse the order of the bits in \p x
+constexpr std::uint64_t reverse_bits(std::uint64_t x) {
+  x = (x >> 1 & 0x5555555555555555) | (x & 0x5555555555555555) << 1;
+  x = (x >> 2 & 0x3333333333333333) | (x & 0x3333333333333333) << 2;
+  x = (x >> 4 & 0x0f0f0f0f0f0f0f0f) | (x & 0x0f0f0f0f0f0f0f0f) << 4;
+  x = (x >> 8 & 0x00ff00ff00ff00ff) | (x & 0x00ff00ff00ff00ff) << 8;
+  x = (x >> 16 & 0x0000ffff0000ffff) | (x & 0x0000ffff0000ffff) << 16;
+  return x >> 32 | x << 32;
+}
+
+template <std::size_t N, std::uint64_t TAIL,
+          BitOrder ORDER = BitOrder::Natural,
+          Reduction REDUCTION = default_reduction(TAIL)>
+class Polynomial {
+  static_assert(N >= 64 && N % 64 == 0, "N must be a multiple of 64");
+  // The overflow of the first fold is below x^(2 * deg(TAIL)), so a second
+  // fold always lands inside the field.
+  static_assert(TAIL != 0 && std::bit_width(TAIL) <= N / 2,
+                "The degree of TAIL must be less than N / 2");
+  static_assert(ORDER == BitOrder::Natural || (N == 128 && TAIL == 0x87),
+                "Reflected fields are only supported for GCM");
+
+public:
+  static constexpr std::size_t BITS = N;
+  static constexpr std::size_t LIMBS = N / 64;
+  using Limbs = std::array<std::uint64_t, LIMBS>;
+
+  /// @brief construct an element from its limbs, least significant first
+  constexpr explicit Polynomial(const Limbs &limbs) : m_limbs(limbs) {}
+
+  static constexpr Polynomial zero() { return Polynomial(Limbs{}); }
+
+  static constexpr Polynomial one() {
+    Limbs limbs{};
+    if constexpr (ORDER == BitOrder::Natural) {
+      limbs.front() = 1;
+    } else {
+      limbs.back() = 1llu << 63;
+    }
+    return Polynomial(limbs);
+  }
+
+  /// @brief generate a random element
+  /// @return an element with each coefficient set with roughly 50%
+  /// probability.
+  static Polynomial random() {
+    Limbs limbs;
+    Random::generator().fill(limbs);
+    return Polynomial(limbs);
+  }
+
+  constexpr const Limbs &limbs() const { return m_limbs; }
+
+  constexpr Polynomial &operator+=(const Polynomial &rhs) {
+    for (std::size_t i = 0; i < LIMBS; ++i) {
+      m_limbs[i] ^= rhs.m_limbs[i];
+    }
+    return *this;
+  }
+
+  constexpr Polynomial &operator-=(const Polynomial &rhs) {
+    return *this += rhs;
+  }
+
+  constexpr Polynomial &operator*=(const Polynomial &rhs) {
+    if constexpr (ORDER == BitOrder::Reflected) {
+      if (std::is_constant_evaluated()) {
+        *this = from_natural(to_natural(*this) * to_natural(rhs));
+        return *this;
+      }
+      this->store(GCM::Backend::multiply(this->load(), rhs.load()));
+    } else if (std::is_constant_evaluated() || !GCM::Backend::pclmul()) {
+      m_limbs = multiply_limbs<false>(m_limbs, rhs.m_limbs);
+    } else {
+      m_limbs = multiply_pclmul(m_limbs, rhs.m_limbs);
+    }
+    return *this;
+  }
+
+  /// @brief calculate x^2. The cross terms cancel in characteristic 2, so
+  /// this needs one carry-less multiplication per limb.
+  constexpr Polynomial square() const {
+    if constexpr (ORDER == BitOrder::Reflected) {
+      if (std::is_constant_evaluated()) {
+        return from_natural(to_natural(*this).square());
+      }
+      Polynomial out = *this;
+      out.store(GCM::Backend::square(this->load()));
+      return out;
+    } else if (std::is_constant_evaluated() || !GCM::Backend::pclmul()) {
+      return Polynomial(square_limbs<false>(m_limbs));
+    } else {
+      return Polynomial(square_pclmul(m_limbs));
+    }
+  }
+
+  /// @brief calculate x^ \p exponent by square-and-multiply
+  constexpr Polynomial pow(std::uint64_t exponent) const {
+    Polynomial out = one();
+    Polynomial base = *this;
+    for (; exponent != 0; exponent >>= 1) {
+      if (exponent & 1) {
+        out *= base;
+      }
+      base = base.square();
+    }
+    return out;
+  }
+
+  /// @brief calculate the multiplicative inverse `x^(2^N - 2)` with the
+  /// Itoh-Tsujii addition chain along the binary expansion of N - 1
+  /// @return the inverse, or zero for zero
+  constexpr Polynomial modular_inverse() const {
+    // beta(k) = x^(2^k - 1), beta(2k) = beta(k)^(2^k) * beta(k) and
+    // beta(k + 1) = beta(k)^2 * x
+    Polynomial beta = *this;
+    std::size_t k = 1;
+    for (int bit = std::bit_width(N - 1) - 2; bit >= 0; --bit) {
+      Polynomial doubled = beta;
+      for (std::size_t i = 0; i < k; ++i) {
+        doubled = doubled.square();
+      }
+      beta = doubled * beta;
+      k *= 2;
+      if ((N - 1) >> bit & 1) {
+        beta = beta.square() * *this;
+        k += 1;
+      }
+    }
+    return beta.square();
+  }
+
+  constexpr Polynomial &operator/=(const Polynomial &rhs) {
+    return *this *= rhs.modular_inverse();
+  }
+
+  friend constexpr Polynomial operator+(Polynomial lhs, const Polynomial &rhs) {
+    return lhs += rhs;
+  }
+
+  friend constexpr Polynomial operator-(Polynomial lhs, const Polynomial &rhs) {
+    return lhs -= rhs;
+  }
+
+  friend constexpr Polynomial operator*(Polynomial lhs, const Polynomial &rhs) {
+    return lhs *= rhs;
+  }
+
+  friend constexpr Polynomial operator/(Polynomial lhs, const Polynomial &rhs) {
+    return lhs /= rhs;
+  }
+
+  friend constexpr bool operator==(const Polynomial &lhs, const Polynomial &rhs) {
+    return lhs.m_limbs == rhs.m_limbs;
+  }
+
+  friend std::ostream &operator<<(std::ostream &os, const Polynomial &poly) {
+    auto flags = os.flags();
+    os << std::hex;
+    for (std::size_t i = LIMBS; i-- > 0;) {
+      os << poly.m_limbs[i] << (i != 0 ? ":" : "");
+    }
+    os.flags(flags);
+    return os;
+  }
+
+private:
+  using NaturalPolynomial = Polynomial<N, TAIL, BitOrder::Natural, REDUCTION>;
+
+  /// @brief reverse the bit order, mapping between the Reflected and the
+  /// Natural representation of the same element
+  static constexpr NaturalPolynomial to_natural(const Polynomial &x)
+    requires(ORDER == BitOrder::Reflected)
+  {
+    typename NaturalPolynomial::Limbs limbs;
+    for (std::size_t i = 0; i < LIMBS; ++i) {
+      limbs[i] = reverse_bits(x.m_limbs[LIMBS - 1 - i]);
+    }
+    return NaturalPolynomial(limbs);
+  }
+
+  static constexpr Polynomial from_natural(const NaturalPolynomial &x)
+    requires(ORDER == BitOrder::Reflected)
+  {
+    Limbs limbs;
+    for (std::size_t i = 0; i < LIMBS; ++i) {
+      limbs[i] = reverse_bits(x.limbs()[LIMBS - 1 - i]);
+    }
+    return Polynomial(limbs);
+  }
+
+  __m128i load() const
+    requires(N == 128)
+  {
+    return _mm_set_epi64x(static_cast<long long>(m_limbs[1]),
+                          static_cast<long long>(m_limbs[0]));
+  }
+
+  void store(__m128i x)
+    requires(N == 128)
+  {
+    m_limbs = {static_cast<std::uint64_t>(_mm_cvtsi128_si64(x)),
+               static_cast<std::uint64_t>(_mm_extract_epi64(x, 1))};
+  }
+
+  /// @brief the exponents of the terms of TAIL
+  static constexpr auto TAPS = []() {
+    std::array<int, std::popcount(TAIL)> taps{};
+    std::size_t i = 0;
+    for (std::uint64_t tail = TAIL; tail != 0; tail &= tail - 1) {
+      taps[i++] = std::countr_zero(tail);
+    }
+    return taps;
+  }();
+
+  /// @brief the product of \p a and \p b, using PCLMULQDQ if \p PCLMUL
+  template <bool PCLMUL>
+  static constexpr Limbs multiply_limbs(const Limbs &a, const Limbs &b) {
+    std::array<std::uint64_t, 2 * LIMBS> wide{};
+    for (std::size_t i = 0; i < LIMBS; ++i) {
+      for (std::size_t j = 0; j < LIMBS; ++j) {
+        auto [low, high] = PCLMUL ? clmul64_pclmul(a[i], b[j])
+                                  : clmul64_portable(a[i], b[j]);
+        wide[i + j] ^= low;
+        wide[i + j + 1] ^= high;
+      }
+    }
+    return reduce<PCLMUL>(wide);
+  }
+
+  /// @brief the square of \p a, using PCLMULQDQ if \p PCLMUL
+  template <bool PCLMUL> static constexpr Limbs square_limbs(const Limbs &a) {
+    std::array<std::uint64_t, 2 * LIMBS> wide;
+    for (std::size_t i = 0; i < LIMBS; ++i) {
+      auto [low, high] =
+          PCLMUL ? clmul64_pclmul(a[i], a[i]) : clsquare64_portable(a[i]);
+      wide[2 * i] = low;
+      wide[2 * i + 1] = high;
+    }
+    return reduce<PCLMUL>(wide);
+  }
+
+  // The PCLMULQDQ entry points. flatten inlines the whole product, including
+  // clmul64_pclmul(), which could not be inlined into a caller without the
+  // pclmul target.
+
+  CPU_TARGET("pclmul") __attribute__((flatten)) static Limbs
+  multiply_pclmul(const Limbs &a, const Limbs &b) {
+    return multiply_limbs<true>(a, b);
+  }
+
+  CPU_TARGET("pclmul") __attribute__((flatten)) static Limbs
+  square_pclmul(const Limbs &a) {
+    return square_limbs<true>(a);
+  }
+
+  /// @brief calculate \p limb * TAIL
+  /// @return the low and high limb of the product
+  template <bool PCLMUL>
+  static constexpr std::array<std::uint64_t, 2> multiply_tail(std::uint64_t limb) {
+    if constexpr (REDUCTION == Reduction::ShiftXor) {
+      std::uint64_t low = 0, high = 0;
+      [&]<std::size_t... I>(std::index_sequence<I...>) {
+        ((low ^= limb << TAPS[I],
+          high ^= TAPS[I] == 0 ? 0 : limb >> (64 - TAPS[I] % 64)),
+         ...);
+      }(std::make_index_sequence<TAPS.size()>());
+      return {low, high};
+    } else if constexpr (PCLMUL) {
+      return clmul64_pclmul(limb, TAIL);
+    } else {
+      return clmul64_portable(limb, TAIL);
+    }
+  }
+
+  /// @brief reduce a wide product modulo `x^N + TAIL`
+  template <bool PCLMUL>
+  static constexpr Limbs reduce(const std::array<std::uint64_t, 2 * LIMBS> &wide) {
+    Limbs out;
+    std::uint64_t carry = 0;
+    for (std::size_t i = 0; i < LIMBS; ++i) {
+      auto [low, high] = multiply_tail<PCLMUL>(wide[LIMBS + i]);
+      out[i] = wide[i] ^ low ^ carry;
+      carry = high;
+    }
+    // carry * TAIL is below x^(2 * deg(TAIL)) <= x^N, so it fits into the
+    // lowest limbs without another fold.
+    auto [low, high] = multiply_tail<PCLMUL>(carry);
+    out[0] ^= low;
+    if constexpr (LIMBS > 1) {
+      out[1] ^= high;
+    }
+    return out;
+  }
+
+  Limbs m_limbs;
+};
+
+} // namespace Galois
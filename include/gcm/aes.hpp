@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <emmintrin.h>
+#include <span>
+
+#include "cpu.hpp"
+
+/**
+ * @brief AES-128 with AES-NI, for kernels which interleave the AES rounds with
+ * other work.
+ *
+ * Botan's block ciphers only encrypt whole buffers, so a kernel which hashes
+ * one batch of blocks while encrypting the next needs the round keys itself.
+ * Everything here requires AES-NI, check aesni() first.
+ */
+namespace GCM::AES {
+
+/// @brief whether the host supports AES-NI. Cached, it is checked once per
+/// message.
+inline bool aesni() {
+  static const bool supported = CPU::features().aesni;
+  return supported;
+}
+
+/// @brief the expanded AES-128 key
+class Key128 {
+public:
+  static constexpr std::size_t ROUNDS = 10;
+  /// @brief a plain array, templates over `__m128i` drop its attributes
+  using RoundKeys = __m128i[ROUNDS + 1];
+
+  /// @brief expand \p key with `aeskeygenassist`
+  explicit Key128(std::span<const std::uint8_t, 16> key);
+
+  /// @brief the round keys, starting with the key itself
+  const RoundKeys &round_keys() const { return m_round_keys; }
+
+  /// @brief encrypt a single block, which is loaded from memory unchanged
+  CPU_TARGET("aes") __m128i encrypt(__m128i block) const;
+
+private:
+  alignas(16) RoundKeys m_round_keys;
+};
+
+} // namespace GCM::AES
@@ -0,0 +1,71 @@
+#pragma once
+#include <emmintrin.h>
+
+#include "cpu.hpp"
+#include "gcm/clmul.hpp"
+#include "gcm/table.hpp"
+
+/**
+ * @brief Runtime selection between the GF(2^128) multiplication backends.
+ *
+ * GCM::CLMUL needs PCLMULQDQ, GCM::Table runs everywhere. The choice is made
+ * once from CPU::features, so the same binary uses carry-less multiplication
+ * where it is available and falls back to Shoup's tables elsewhere.
+ */
+namespace GCM::Backend {
+
+/// @brief a GF(2^128) multiplication backend
+enum class Kind {
+  /// GCM::CLMUL, requires PCLMULQDQ
+  Clmul,
+  /// GCM::Table, portable
+  Table,
+};
+
+/// @brief set during static initialization, so that reading it needs no guard
+/// unlike a function-local static. Products in static initializers which run
+/// earlier see false and use GCM::Table, with the same results.
+inline const bool PCLMUL_SUPPORTED = CPU::features().pclmul;
+
+/// @brief whether the host supports PCLMULQDQ. Cheap enough to check before
+/// every multiplication.
+inline bool pclmul() { return PCLMUL_SUPPORTED; }
+
+/// @brief the fastest backend supported by the host
+inline Kind preferred() { return pclmul() ? Kind::Clmul : Kind::Table; }
+
+/// @brief multiply two field elements using the preferred backend
+inline __m128i multiply(__m128i a, __m128i b) {
+  return pclmul() ? GCM::CLMUL::multiply(a, b) : GCM::Table::multiply(a, b);
+}
+
+/// @brief square a field element using the preferred backend
+inline __m128i square(__m128i a) {
+  return pclmul() ? GCM::CLMUL::square(a) : GCM::Table::square(a);
+}
+
+// multiply() and square() check the backend on every call, and the pclmul
+// product cannot be inlined into their untargeted callers. Loops over many
+// products are instead written once as a template over one of the following,
+// and instantiated in a CPU_TARGET("pclmul") entry point and a portable one,
+// so that the backend is chosen once per loop.
+
+/// @brief the products of GCM::CLMUL, only for CPU_TARGET("pclmul") callers
+struct ClmulOps {
+  CPU_TARGET("pclmul") static __m128i multiply(__m128i a, __m128i b) {
+    return GCM::CLMUL::multiply(a, b);
+  }
+  CPU_TARGET("pclmul") static __m128i square(__m128i a) {
+    return GCM::CLMUL::square(a);
+  }
+};
+
+/// @brief the products of GCM::Table
+struct TableOps {
+  static __m128i multiply(__m128i a, __m128i b) {
+    return GCM::Table::multiply(a, b);
+  }
+  static __m128i square(__m128i a) { return GCM::Table::square(a); }
+};
+
+} // namespace GCM::Backend
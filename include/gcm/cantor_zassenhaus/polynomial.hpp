@@ -79,6 +79,10 @@ public:
   /// nonzero.
   void ensure_normalized();
 
+  /// @brief calculate the square of this polynomial. The cross terms cancel
+  /// in characteristic 2, so this only squares each coefficient.
+  Polynomial square() const;
+
   Polynomial pow(__m128i exponent, Polynomial mod) const;
 
   Polynomial &operator<<=(std::size_t amount) {
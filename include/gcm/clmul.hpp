@@ -0,0 +1,185 @@
+#pragma once
+#include <cstdint>
+#include <emmintrin.h>
+#include <smmintrin.h>
+#include <vector>
+#include <wmmintrin.h>
+
+#include "cpu.hpp"
+
+/**
+ * @brief Inline carry-less multiplication kernels for GF(2^128) in GCM
+ * convention.
+ *
+ * A product is computed in two steps: multiply_wide() returns the unreduced
+ * 256-bit product and reduce() shifts it into place and reduces it modulo
+ * `x^128 + x^7 + x^2 + x + 1`. Both steps are linear, so the wide products of
+ * several terms can be XORed together and reduced once, which is what dot
+ * products and aggregated GHASH are built on.
+ *
+ * The algorithms follow the Intel white paper "Intel Carry-Less Multiplication
+ * Instruction and its Usage for Computing the GCM Mode" (rev. 2.02).
+ *
+ * The kernels need PCLMULQDQ, which is not part of the baseline instruction
+ * set. They are compiled with CPU_TARGET("pclmul") and must only be called
+ * after checking CPU::features, which GCM::Backend does for single products.
+ *
+ * For many independent products, the Kernels below apply the same algorithm
+ * to 2 or 4 field elements per instruction using VPCLMULQDQ on 256-bit or
+ * 512-bit registers. The GHASH kernels multiply a group of blocks by the key
+ * powers the same way. The widest kernel supported by the host is selected
+ * at runtime from CPU::features. Hosts without PCLMULQDQ fall back to the
+ * GCM::Table kernels.
+ */
+namespace GCM::CLMUL {
+
+/// @brief an unreduced 256-bit carry-less product, as computed from two
+/// bit-reflected factors (i.e. not yet shifted left by one)
+struct Wide {
+  __m128i low;
+  __m128i high;
+};
+
+/// @brief the additive identity for accumulate()
+inline Wide zero() { return {_mm_setzero_si128(), _mm_setzero_si128()}; }
+
+/// @brief multiply \p a and \p b without reducing the result, using three
+/// carry-less multiplications (Karatsuba)
+CPU_TARGET("pclmul") inline Wide multiply_wide(__m128i a, __m128i b) {
+  __m128i low = _mm_clmulepi64_si128(a, b, 0x00);
+  __m128i high = _mm_clmulepi64_si128(a, b, 0x11);
+  __m128i a_folded = _mm_xor_si128(a, _mm_shuffle_epi32(a, 0x4e));
+  __m128i b_folded = _mm_xor_si128(b, _mm_shuffle_epi32(b, 0x4e));
+  __m128i middle = _mm_clmulepi64_si128(a_folded, b_folded, 0x00);
+  middle = _mm_xor_si128(middle, _mm_xor_si128(low, high));
+  return {_mm_xor_si128(low, _mm_slli_si128(middle, 8)),
+          _mm_xor_si128(high, _mm_srli_si128(middle, 8))};
+}
+
+/// @brief add \p term to \p sum
+inline void accumulate(Wide &sum, const Wide &term) {
+  sum.low = _mm_xor_si128(sum.low, term.low);
+  sum.high = _mm_xor_si128(sum.high, term.high);
+}
+
+/// @brief reduce a wide product to a field element
+inline __m128i reduce(const Wide &product) {
+  __m128i tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8, tmp9;
+  tmp3 = product.low;
+  tmp6 = product.high;
+
+  // The factors are bit-reflected, so the product is off by one bit
+  tmp7 = _mm_srli_epi32(tmp3, 31);
+  tmp8 = _mm_srli_epi32(tmp6, 31);
+  tmp3 = _mm_slli_epi32(tmp3, 1);
+  tmp6 = _mm_slli_epi32(tmp6, 1);
+  tmp9 = _mm_srli_si128(tmp7, 12);
+  tmp8 = _mm_slli_si128(tmp8, 4);
+  tmp7 = _mm_slli_si128(tmp7, 4);
+  tmp3 = _mm_or_si128(tmp3, tmp7);
+  tmp6 = _mm_or_si128(tmp6, tmp8);
+  tmp6 = _mm_or_si128(tmp6, tmp9);
+
+  // Reduce the low half into the high half
+  tmp7 = _mm_slli_epi32(tmp3, 31);
+  tmp8 = _mm_slli_epi32(tmp3, 30);
+  tmp9 = _mm_slli_epi32(tmp3, 25);
+  tmp7 = _mm_xor_si128(tmp7, tmp8);
+  tmp7 = _mm_xor_si128(tmp7, tmp9);
+  tmp8 = _mm_srli_si128(tmp7, 4);
+  tmp7 = _mm_slli_si128(tmp7, 12);
+  tmp3 = _mm_xor_si128(tmp3, tmp7);
+  tmp2 = _mm_srli_epi32(tmp3, 1);
+  tmp4 = _mm_srli_epi32(tmp3, 2);
+  tmp5 = _mm_srli_epi32(tmp3, 7);
+  tmp2 = _mm_xor_si128(tmp2, tmp4);
+  tmp2 = _mm_xor_si128(tmp2, tmp5);
+  tmp2 = _mm_xor_si128(tmp2, tmp8);
+  tmp3 = _mm_xor_si128(tmp3, tmp2);
+  return _mm_xor_si128(tmp6, tmp3);
+}
+
+/// @brief multiply two field elements
+CPU_TARGET("pclmul") inline __m128i multiply(__m128i a, __m128i b) {
+  return reduce(multiply_wide(a, b));
+}
+
+/// @brief square a field element. The cross terms of a square cancel out, so
+/// this needs only two carry-less multiplications.
+CPU_TARGET("pclmul") inline __m128i square(__m128i a) {
+  return reduce({_mm_clmulepi64_si128(a, a, 0x00),
+                 _mm_clmulepi64_si128(a, a, 0x11)});
+}
+
+/// @brief `out[i] = a[i] * b[i]` for \p count elements. \p out may alias \p a
+/// or \p b .
+typedef void (*multiply_kernel)(const __m128i *a, const __m128i *b,
+                                __m128i *out, std::size_t count);
+
+/// @brief `out[i] = a[i] * scalar` for \p count elements. \p out may alias
+/// \p a .
+typedef void (*scale_kernel)(const __m128i *a, __m128i scalar, __m128i *out,
+                             std::size_t count);
+
+/// @brief the sum of `a[i] * b[i]` for \p count elements, reduced once
+typedef __m128i (*dot_kernel)(const __m128i *a, const __m128i *b,
+                              std::size_t count);
+
+/// @brief the number of blocks a ghash_kernel sums up with one reduction
+constexpr std::size_t GHASH_BLOCKS = 8;
+
+/// @brief add \p count blocks in GCM byte order at \p data to \p tag .
+/// Horner's rule is applied to GHASH_BLOCKS blocks at once:
+/// (((X + B_1) * H + B_2) * H + ...) * H
+///   = (X + B_1) * H^k + B_2 * H^(k-1) + ... + B_k * H
+/// so each group costs one reduction. \p powers holds
+/// `H^GHASH_BLOCKS, ..., H^2, H`; the wide kernels derive higher powers from
+/// them to sum up larger groups of long messages. Returns the new tag.
+typedef __m128i (*ghash_kernel)(__m128i tag, const std::uint8_t *data,
+                                std::size_t count, const __m128i *powers);
+
+/// @brief the batch kernels for one instruction set, together with a human
+/// readable name
+struct Kernels {
+  const char *name;
+  multiply_kernel multiply;
+  scale_kernel scale;
+  dot_kernel dot;
+  ghash_kernel ghash;
+};
+
+void multiply_pclmul(const __m128i *a, const __m128i *b, __m128i *out,
+                     std::size_t count);
+void multiply_vpclmul256(const __m128i *a, const __m128i *b, __m128i *out,
+                         std::size_t count);
+void multiply_vpclmul512(const __m128i *a, const __m128i *b, __m128i *out,
+                         std::size_t count);
+
+void scale_pclmul(const __m128i *a, __m128i scalar, __m128i *out,
+                  std::size_t count);
+void scale_vpclmul256(const __m128i *a, __m128i scalar, __m128i *out,
+                      std::size_t count);
+void scale_vpclmul512(const __m128i *a, __m128i scalar, __m128i *out,
+                      std::size_t count);
+
+__m128i dot_pclmul(const __m128i *a, const __m128i *b, std::size_t count);
+__m128i dot_vpclmul256(const __m128i *a, const __m128i *b, std::size_t count);
+__m128i dot_vpclmul512(const __m128i *a, const __m128i *b, std::size_t count);
+
+__m128i ghash_pclmul(__m128i tag, const std::uint8_t *data, std::size_t count,
+                     const __m128i *powers);
+__m128i ghash_vpclmul256(__m128i tag, const std::uint8_t *data,
+                         std::size_t count, const __m128i *powers);
+__m128i ghash_vpclmul512(__m128i tag, const std::uint8_t *data,
+                         std::size_t count, const __m128i *powers);
+
+/// @brief all batch kernels which the host CPU can execute, widest first. The
+/// GCM::Table kernels are always supported.
+/// @return the supported kernels
+std::vector<Kernels> supported_kernels();
+
+/// @brief the widest batch kernels which the host CPU can execute
+/// @return the kernels, determined once and cached afterwards
+const Kernels &best_kernels();
+
+} // namespace GCM::CLMUL
@@ -0,0 +1,87 @@
+#pragma once
+#include <array>
+#include <botan/block_cipher.h>
+#include <cstdint>
+#include <emmintrin.h>
+#include <span>
+#include <vector>
+
+namespace GCM {
+
+/// @brief derive the pre-counter block Y0 from the nonce: `Nonce || 1` for
+/// 12 byte nonces, `GHASH_H(Nonce)` otherwise
+/// @param cipher the block cipher, which also gives the auth key `H = E(0)`
+/// @param nonce the nonce
+/// @return Y0
+std::vector<std::uint8_t> derive_y0(const Botan::BlockCipher &cipher,
+                                    std::span<const std::uint8_t> nonce);
+
+/// @brief The CTR mode of GCM. The message block i is XORed with
+/// `E(Y0 + 1 + i)`, where the addition only affects the last four bytes of
+/// Y0 as a big endian counter.
+///
+/// The keystream is generated KEYSTREAM_BLOCKS blocks at a time and XORed onto
+/// whole blocks, only the keystream of a partial block at the end of a call is
+/// kept for the next one. Encryption and decryption are the same operation.
+class CounterMode {
+public:
+  /// @brief the number of counter blocks which are encrypted with a single
+  /// call to the block cipher, so that its implementation can pipeline them
+  static constexpr std::size_t KEYSTREAM_BLOCKS = 16;
+
+  /// @brief start the keystream
+  /// @param cipher the block cipher, which must outlive the CounterMode
+  /// @param y0 the pre-counter block, see derive_y0()
+  /// @param y the increment of Y0 for the first block, 1 at the start of a
+  /// message
+  CounterMode(const Botan::BlockCipher &cipher,
+              std::span<const std::uint8_t, 16> y0, std::uint32_t y = 1);
+
+  /// @brief the counter block `Y0 + y`
+  std::vector<std::uint8_t> y_block(std::uint32_t y) const;
+
+  /// @brief XOR the keystream onto \p input
+  /// @param input the plaintext or ciphertext
+  /// @param output receives the result, same size as \p input . May alias
+  /// \p input .
+  void apply(std::span<const std::uint8_t> input,
+             std::span<std::uint8_t> output);
+
+  /// @brief the number of keystream bytes left over from the last partial
+  /// block. After that many bytes, the next byte starts a new block.
+  std::size_t remaining_keystream() const { return 16 - m_keystream_used; }
+
+  /// @brief Y0 in a register, for kernels which generate the counter blocks
+  /// themselves
+  __m128i y0_block() const { return m_y0_block; }
+
+  /// @brief the big endian counter of the next block
+  std::uint32_t next_counter() const { return m_y0_counter + m_y; }
+
+  /// @brief skip whole blocks which a kernel has processed itself. Only
+  /// valid if remaining_keystream() is zero.
+  /// @param blocks the number of blocks
+  void skip_blocks(std::uint32_t blocks);
+
+  /// @brief a copy which starts \p blocks whole blocks after the next one,
+  /// e.g. for another thread. Only valid if remaining_keystream() is zero.
+  /// @param blocks the number of blocks to skip in the copy
+  CounterMode fork(std::uint32_t blocks) const;
+
+private:
+  /// @brief encrypt the next out.size() / 16 counter blocks
+  /// @param out a multiple of 16 bytes, at most KEYSTREAM_BLOCKS blocks
+  void keystream(std::span<std::uint8_t> out);
+
+  const Botan::BlockCipher &m_cipher;
+  __m128i m_y0_block;
+  /// @brief the counter of Y0, which y_block() increments
+  std::uint32_t m_y0_counter;
+  std::uint32_t m_y;
+  /// @brief the keystream of the last partial block. Its first
+  /// m_keystream_used bytes are used up already.
+  std::array<std::uint8_t, 16> m_keystream;
+  std::size_t m_keystream_used;
+};
+
+} // namespace GCM
@@ -0,0 +1,65 @@
+#pragma once
+#include <botan/block_cipher.h>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <vector>
+
+#include "gcm/counter_mode.hpp"
+#include "gcm/ghash.hpp"
+
+namespace GCM {
+
+/// @brief The inverse of GCM::Encryptor. The ciphertext is hashed before it
+/// is decrypted, so the plaintext of every update() is unauthenticated until
+/// verify() has succeeded and must not be released before.
+class Decryptor {
+public:
+  /// @brief start a new decryption process
+  /// @param associated_data the associated data of the message
+  /// @param cipher the block cipher for CTR mode
+  /// @param nonce the nonce of the message
+  Decryptor(std::span<const std::uint8_t> associated_data,
+            std::unique_ptr<Botan::BlockCipher> cipher,
+            std::span<const std::uint8_t> nonce);
+
+  /// @brief decrypt the next part of the ciphertext
+  /// @param ciphertext the ciphertext to decrypt
+  /// @param plaintext receives the plaintext, same size as \p ciphertext .
+  /// May alias \p ciphertext .
+  void update(std::span<const std::uint8_t> ciphertext,
+              std::span<std::uint8_t> plaintext);
+
+  /// @brief decrypt the next part of the ciphertext in place
+  /// @param ciphertext the ciphertext to decrypt
+  /// @return the corresponding plaintext
+  std::vector<std::uint8_t> update(std::vector<std::uint8_t> ciphertext) {
+    this->update(ciphertext, ciphertext);
+    return ciphertext;
+  }
+
+  /// @brief decrypt everything that can be read from \p input and write it to
+  /// \p output , one Stream::CHUNK_SIZE chunk at a time. The memory use does
+  /// not depend on the length of the stream.
+  /// @param input the stream to read the ciphertext from
+  /// @param output the stream to write the unauthenticated plaintext to
+  /// @return the number of bytes processed
+  /// @throws std::runtime_error if reading or writing fails
+  std::uint64_t process_stream(std::istream &input, std::ostream &output);
+
+  /// @brief finish the decryption and compare the auth tag in constant time
+  /// @param auth_tag the expected auth tag
+  /// @return whether \p auth_tag is valid for the associated data and all
+  /// ciphertext
+  bool verify(std::span<const std::uint8_t> auth_tag);
+
+private:
+  const std::unique_ptr<Botan::BlockCipher> m_cipher;
+  const std::vector<std::uint8_t> m_y0;
+  GCM::CounterMode m_ctr;
+  GCM::GHASH m_hasher;
+};
+
+} // namespace GCM
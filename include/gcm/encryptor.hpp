@@ -1,9 +1,15 @@
 #pragma once
+#include <array>
 #include <botan/block_cipher.h>
 #include <cstdint>
+#include <optional>
+#include <span>
 #include <vector>
 
+#include "gcm/aes.hpp"
+#include "gcm/counter_mode.hpp"
 #include "gcm/ghash.hpp"
+#include "parallel.hpp"
 
 namespace GCM {
 
@@ -16,6 +22,17 @@ struct EncryptionResult {
 
 class Encryptor {
 public:
+  /// @brief how update() processes whole blocks
+  enum class Mode {
+    /// encrypt a batch of blocks with the block cipher, then hash it
+    TwoPass,
+    /// interleave the AES rounds of each batch of blocks with the GHASH
+    /// multiplications of the previous batch, while both are in registers.
+    /// Requires an AES-128 key, AES-NI and PCLMULQDQ, otherwise this falls
+    /// back to Mode::TwoPass.
+    Stitched,
+  };
+
   /// @brief start a new encryption process
   /// @param associated_data the associated data for the encryption
   /// @param cipher the block cipher for CTR mode
@@ -24,10 +41,49 @@ public:
             const std::unique_ptr<Botan::BlockCipher> cipher,
             const std::vector<std::uint8_t> &nonce);
 
-  /// @brief encrypt a given plaintext and update the internal state
+  /// @brief start a new AES-128 encryption process
+  /// @param associated_data the associated data for the encryption
+  /// @param aes_128_key the AES-128 key
+  /// @param nonce the nonce to use for CTR mode
+  /// @param mode how to process whole blocks
+  Encryptor(std::vector<std::uint8_t> associated_data,
+            std::span<const std::uint8_t> aes_128_key,
+            const std::vector<std::uint8_t> &nonce, Mode mode = Mode::Stitched);
+
+  /// @brief the mode which update() actually uses
+  Mode mode() const {
+    return m_aes_128_key ? Mode::Stitched : Mode::TwoPass;
+  }
+
+  /// @brief encrypt a given plaintext and update the internal state, see
+  /// GCM::CounterMode
+  /// @param plaintext the plaintext to encrypt
+  /// @param ciphertext receives the ciphertext, same size as \p plaintext .
+  /// May alias \p plaintext .
+  void update(std::span<const std::uint8_t> plaintext,
+              std::span<std::uint8_t> ciphertext);
+
+  /// @brief encrypt a large plaintext on multiple threads. The counter block
+  /// of every block is known in advance, so the whole blocks are split into
+  /// one chunk per thread. Each thread encrypts its chunk with its own
+  /// keystream and hashes the resulting ciphertext starting from zero, and the
+  /// partial tags are combined with GCM::GHASH::combine_chunks(). The result
+  /// is identical to update().
+  /// @param plaintext the plaintext to encrypt
+  /// @param ciphertext receives the ciphertext, same size as \p plaintext .
+  /// May alias \p plaintext .
+  /// @param threads the number of threads to use
+  void update_parallel(std::span<const std::uint8_t> plaintext,
+                       std::span<std::uint8_t> ciphertext,
+                       std::size_t threads = Parallel::default_threads());
+
+  /// @brief encrypt a given plaintext in place and update the internal state
   /// @param plaintext the plaintext to encrypt
   /// @return the ciphertext correspnding to the plaintext
-  std::vector<std::uint8_t> update(std::vector<std::uint8_t> plaintext);
+  std::vector<std::uint8_t> update(std::vector<std::uint8_t> plaintext) {
+    this->update(plaintext, plaintext);
+    return plaintext;
+  }
 
   /// @brief compute the auth tag for the associated data and all encrypted
   /// plaintext
@@ -52,12 +108,33 @@ public:
 private:
 #endif
 
-  std::vector<std::uint8_t> y_block(std::uint32_t ctr);
+  /// @brief encrypt whole blocks independently of the state, for
+  /// update_parallel()
+  /// @param plaintext whole blocks of plaintext
+  /// @param ciphertext receives the ciphertext, same size as \p plaintext
+  /// @param first_block the index of the first block, relative to the next
+  /// block of m_ctr
+  /// @return the GHASH of the ciphertext, starting from zero
+  GCM::Polynomial encrypt_chunk(std::span<const std::uint8_t> plaintext,
+                                std::span<std::uint8_t> ciphertext,
+                                std::uint32_t first_block) const;
+
+  std::vector<std::uint8_t> y_block(std::uint32_t ctr) {
+    return m_ctr.y_block(ctr);
+  }
+
+  /// @brief the AES-128 round keys for Mode::Stitched, expanded on first use.
+  /// Messages shorter than a group of blocks never stitch, so they skip the
+  /// key schedule.
+  const GCM::AES::Key128 &stitched_key();
 
   const std::unique_ptr<Botan::BlockCipher> m_cipher;
-  std::vector<std::uint8_t> m_y0;
-  std::uint32_t m_y;
-  std::vector<std::uint8_t> m_keystream;
+  const std::vector<std::uint8_t> m_y0;
+  GCM::CounterMode m_ctr;
+  /// @brief the AES-128 key, only set with Mode::Stitched
+  std::optional<std::array<std::uint8_t, 16>> m_aes_128_key;
+  /// @brief the round keys of m_aes_128_key, set by stitched_key()
+  std::optional<GCM::AES::Key128> m_stitched_key;
   GCM::GHASH m_hasher;
 };
 
@@ -1,9 +1,16 @@
 #pragma once
+#include <array>
+#include <cassert>
 #include <cstdint>
-#include <deque>
+#include <optional>
+#include <span>
 #include <vector>
 
+#include "gcm/backend.hpp"
+#include "gcm/clmul.hpp"
 #include "gcm/polynomial.hpp"
+#include "gcm/table.hpp"
+#include "parallel.hpp"
 
 namespace GCM {
 
@@ -13,22 +20,96 @@ class GHASH {
   static constexpr std::uint64_t BLOCK_SIZE = 16;
 
 public:
+  /// @brief the number of blocks which are multiplied by powers of the auth
+  /// key and summed up with a single reduction
+  static constexpr std::size_t AGGREGATED_BLOCKS = GCM::CLMUL::GHASH_BLOCKS;
+
+  /// @brief update_parallel() gives every thread at least this many blocks
+  /// (64 KiB), so that combining the partial tags stays negligible
+  static constexpr std::size_t PARALLEL_MIN_BLOCKS = 4096;
+
   /// @brief Start a new GHASH computation
   /// @param associated_data associated data must be known when beginning the
   /// computation
   /// @param auth_key the GHASH auth key
-  GHASH(std::vector<std::uint8_t> associated_data,
-        std::vector<std::uint8_t> auth_key);
+  /// @param backend the multiplication backend. With Backend::Kind::Table, the
+  /// multiples of the auth key are precomputed once (4 KiB).
+  GHASH(std::span<const std::uint8_t> associated_data,
+        std::span<const std::uint8_t> auth_key,
+        Backend::Kind backend = Backend::preferred());
+
+  /// @brief add ciphertext to the GHASH. Whole blocks are read directly from
+  /// \p ciphertext , only a trailing partial block is buffered.
+  /// @param ciphertext ciphertext of any length
+  void update(std::span<const std::uint8_t> ciphertext);
+
+  /// @brief see update(std::span<const std::uint8_t>)
+  void update(const std::vector<std::uint8_t> &ciphertext) {
+    this->update(std::span(ciphertext));
+  }
 
-  /// @brief add ciphertext to the GHASH
+  /// @brief add ciphertext to the GHASH, hashing its blocks on multiple
+  /// threads. GHASH is linear, so the blocks are split into one chunk per
+  /// thread and each chunk is hashed starting from zero. The partial tags are
+  /// then combined as `X = X * H^m + T` for a chunk of m blocks with partial
+  /// tag T, which gives the same result as update().
   /// @param ciphertext ciphertext of any length
-  void update(std::vector<std::uint8_t> ciphertext);
+  /// @param threads the number of threads to use
+  void update_parallel(std::span<const std::uint8_t> ciphertext,
+                       std::size_t threads = Parallel::default_threads());
+
+  /// @brief add whole ciphertext blocks which \p kernel hashes on its own,
+  /// e.g. while it encrypts them. Only valid with Backend::Kind::Clmul and
+  /// while no partial block is buffered, i.e. after a multiple of
+  /// GCM::GHASH::BLOCK_SIZE bytes of ciphertext.
+  /// @param bytes the number of ciphertext bytes, a multiple of
+  /// GCM::GHASH::BLOCK_SIZE
+  /// @param kernel called as `__m128i kernel(__m128i tag,
+  /// std::span<const GCM::Polynomial> powers)` with the current tag and the
+  /// powers `H^AGGREGATED_BLOCKS, ..., H^2, H`. Returns the tag after the
+  /// blocks.
+  template <typename Kernel>
+  void update_blocks(std::size_t bytes, Kernel &&kernel) {
+    assert(!m_finalized && m_buffered == 0 && !m_key_powers.empty() &&
+           bytes % BLOCK_SIZE == 0);
+    m_auth_tag = GCM::Polynomial(kernel(
+        m_auth_tag.to_m128i(), std::span<const GCM::Polynomial>(m_key_powers)));
+    m_ciphertext_bitlength += bytes * 8;
+  }
+
+  /// @brief hash whole blocks, starting from \p tag , without changing the
+  /// state. This is safe to call from multiple threads, e.g. to hash the
+  /// chunks for combine_chunks().
+  /// @param blocks a multiple of GCM::GHASH::BLOCK_SIZE bytes
+  /// @return the tag after all blocks
+  GCM::Polynomial absorb(GCM::Polynomial tag,
+                         std::span<const std::uint8_t> blocks) const;
+
+  /// @brief add ciphertext whose chunks have been hashed separately, each
+  /// starting from zero. The partial tags are combined as `X = X * H^m + T`
+  /// for a chunk of m blocks with partial tag T. Only valid while no partial
+  /// block is buffered.
+  /// @param partial_tags the partial tag of each chunk, in order
+  /// @param chunk_blocks the number of blocks per chunk. Only the last chunk
+  /// can be shorter.
+  /// @param blocks the total number of blocks
+  void combine_chunks(std::span<const GCM::Polynomial> partial_tags,
+                      std::size_t chunk_blocks, std::size_t blocks);
+
+  /// @brief the powers `H^AGGREGATED_BLOCKS, ..., H^2, H` of the auth key, for
+  /// kernels which hash blocks themselves. Empty with Backend::Kind::Table.
+  std::span<const GCM::Polynomial> key_powers() const { return m_key_powers; }
 
   /// @brief finalize the computation and return the result
   /// @return the authentication tag for all inserted data
   std::vector<std::uint8_t> finalize();
 
 private:
+
+  /// @brief add whole blocks to the tag, without counting their length
+  /// @param blocks a multiple of GCM::GHASH::BLOCK_SIZE bytes
+  void absorb_blocks(std::span<const std::uint8_t> blocks);
+
   /// @brief pad the current ciphertext block with zeros and add it to the tag
   void pad_current_block();
 
@@ -36,16 +117,119 @@ private:
   GCM::Polynomial m_auth_tag;
 
   const GCM::Polynomial m_auth_key;
+
+  /// @brief the powers `H^AGGREGATED_BLOCKS, ..., H^2, H` of the auth key `H`,
+  /// only used with Backend::Kind::Clmul
+  std::vector<GCM::Polynomial> m_key_powers;
+
+  /// @brief the table of the auth key, only used with Backend::Kind::Table
+  std::optional<GCM::Table::Key> m_key_table;
   const std::uint64_t m_associated_data_bitlength;
   std::uint64_t m_ciphertext_bitlength;
 
-  /// @brief the ciphertext buffer contains all "remaining" ciphertext data. Its
-  /// length is always less than GCM::GHASH::BLOCK_SIZE. It is a std::deque
-  /// because we insert at the end and remove from the beginning.
-  std::deque<std::uint8_t> m_ciphertext_buffer;
+  /// @brief the staging buffer for a partial block. Only the first
+  /// m_buffered bytes are valid, which is always less than
+  /// GCM::GHASH::BLOCK_SIZE.
+  std::array<std::uint8_t, BLOCK_SIZE> m_buffer;
+  std::size_t m_buffered;
   bool m_finalized;
 };
 
+/// @brief A finished GHASH tag which is updated in place when blocks of its
+/// input change, instead of hashing the whole input again.
+///
+/// The GHASH of blocks B_1, ..., B_n (the padded associated data, the padded
+/// ciphertext and the length block) is the sum of B_i * H^(n - i + 1), so
+/// replacing a block adds (old + new) * H^(n - i + 1). The power costs
+/// O(log n) multiplications. Since the final GCM tag only XORs a constant mask
+/// onto the GHASH, the same updates apply to masked tags.
+class IncrementalGHASH {
+public:
+  /// @brief start from an existing tag
+  /// @param tag the GHASH of the current input
+  /// @param auth_key the auth key H
+  /// @param associated_data_bytes the length of the associated data
+  /// @param ciphertext_bytes the length of the ciphertext
+  IncrementalGHASH(GCM::Polynomial tag, GCM::Polynomial auth_key,
+                   std::uint64_t associated_data_bytes,
+                   std::uint64_t ciphertext_bytes);
+
+  /// @brief the number of padded associated data blocks. Ciphertext block i
+  /// has the block index `associated_data_blocks() + i`.
+  std::uint64_t associated_data_blocks() const;
+
+  /// @brief change one block of the padded associated data or ciphertext
+  /// @param index the index of the block in the GHASH input
+  /// @param old_block the current content of the block
+  /// @param new_block the new content of the block
+  /// @throws std::out_of_range if \p index is not an associated data or
+  /// ciphertext block
+  void replace_block(std::uint64_t index, const GCM::Polynomial &old_block,
+                     const GCM::Polynomial &new_block);
+
+  /// @brief append whole blocks to the ciphertext. The length block is
+  /// updated accordingly.
+  /// @param blocks the new ciphertext blocks
+  /// @throws std::logic_error if the ciphertext does not end on a block
+  /// boundary. Replace its last block with the padded new content and use
+  /// set_lengths() first.
+  void append_blocks(std::span<const GCM::Polynomial> blocks);
+
+  /// @brief change the lengths in the length block, without changing any
+  /// other block, e.g. to move the end of the ciphertext within its last
+  /// block
+  /// @param associated_data_bytes the new length of the associated data,
+  /// which must have the same number of blocks
+  /// @param ciphertext_bytes the new length of the ciphertext, which must
+  /// have the same number of blocks
+  /// @throws std::invalid_argument if the number of blocks would change
+  void set_lengths(std::uint64_t associated_data_bytes,
+                   std::uint64_t ciphertext_bytes);
+
+  /// @brief the current tag
+  const GCM::Polynomial &tag() const { return m_tag; }
+
+private:
+  /// @brief the length block for the current lengths
+  GCM::Polynomial length_block() const;
+
+  /// @brief the number of blocks in the GHASH input, including the length
+  /// block
+  std::uint64_t block_count() const;
+
+  /// @brief calculate `H^exponent`
+  GCM::Polynomial key_power(std::uint64_t exponent) const;
+
+  GCM::Polynomial m_tag;
+  const GCM::Polynomial m_auth_key;
+  std::uint64_t m_associated_data_bytes;
+  std::uint64_t m_ciphertext_bytes;
+};
+
+/// @brief one message for ghash_multi()
+struct GHASHInput {
+  std::span<const std::uint8_t> ciphertext;
+  std::span<const std::uint8_t> associated_data;
+  /// @brief the auth key, exactly 16 bytes
+  std::span<const std::uint8_t> key;
+};
+
+/// @brief the number of messages ghash_multi() hashes in lockstep
+constexpr std::size_t GHASH_MULTI_LANES = 8;
+
+/// @brief compute the auth tags of many independent messages, each with its
+/// own key. A single GHASH is a chain of dependent multiplications, so it
+/// waits for the latency of every product. Here, GHASH_MULTI_LANES messages of
+/// similar length advance one block at a time in lockstep, which keeps that
+/// many independent products in flight.
+/// @param inputs the messages
+/// @param backend the multiplication backend
+/// @return the auth tags, in the order of \p inputs , identical to
+/// GCM::ghash()
+std::vector<std::array<std::uint8_t, 16>>
+ghash_multi(std::span<const GHASHInput> inputs,
+            Backend::Kind backend = Backend::preferred());
+
 /// @brief compute an auth tag for a given ciphertext
 /// @param ciphertext the ciphertext
 /// @param associated_data the associated data
@@ -53,7 +237,20 @@ private:
 /// @return the auth tag
 /// @note this is a convience function. For streamable hashing, use the
 /// GCM::GHASH class.
-std::vector<std::uint8_t> ghash(std::vector<std::uint8_t> ciphertext,
-                                std::vector<std::uint8_t> associated_data,
-                                std::vector<std::uint8_t> key);
+std::vector<std::uint8_t> ghash(std::span<const std::uint8_t> ciphertext,
+                                std::span<const std::uint8_t> associated_data,
+                                std::span<const std::uint8_t> key);
+
+/// @brief compute an auth tag for a large ciphertext on multiple threads
+/// @param ciphertext the ciphertext
+/// @param associated_data the associated data
+/// @param key the auth key to use
+/// @param threads the number of threads to use
+/// @return the auth tag, identical to GCM::ghash()
+/// @see GCM::GHASH::update_parallel
+std::vector<std::uint8_t>
+ghash_parallel(std::span<const std::uint8_t> ciphertext,
+               std::span<const std::uint8_t> associated_data,
+               std::span<const std::uint8_t> key,
+               std::size_t threads = Parallel::default_threads());
 } // namespace GCM
\ No newline at end of file
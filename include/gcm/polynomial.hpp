@@ -1,4 +1,6 @@
 #pragma once
+#include <array>
+#include <bit>
 #include <cassert>
 #include <cppcodec/base64_default_rfc4648.hpp>
 #include <emmintrin.h>
@@ -6,18 +8,34 @@
 #include <ranges>
 #include <set>
 #include <smmintrin.h>
+#include <span>
 #include <stdexcept>
 #include <vector>
 
+#include "galois/polynomial.hpp"
+#include "gcm/backend.hpp"
+#include "gcm/clmul.hpp"
+
 namespace GCM {
 
-const __m128i REDUCTION_POLYNOMIAL = _mm_setr_epi64(
-    _mm_set_pi64x(0), _mm_set_pi64x(1 << 7 | 1 << 2 | 1 << 1 | 1 << 0));
+/// the reduction polynomial is `x^128 + REDUCTION_TAIL`
+constexpr std::uint64_t REDUCTION_TAIL = 1 << 7 | 1 << 2 | 1 << 1 | 1 << 0;
+
+/// Frobenius maps up to this many squarings are cheaper to evaluate by
+/// squaring than by table lookups.
+constexpr std::size_t FROBENIUS_TABLE_THRESHOLD = 8;
+
+/// @brief the GCM field as an instantiation of the generic Galois::Polynomial.
+/// It has the same bit layout and arithmetic kernels as GCM::Polynomial, which
+/// adds the GCM specific conversions and batch kernels on top.
+using Field =
+    Galois::Polynomial<128, REDUCTION_TAIL, Galois::BitOrder::Reflected>;
 
-// FIXME: This could instead be a template<std::size_t N> Galois::Polynomial to
-// support arbitrary sized fields with an arbitrary reduction polynomial.
-// However, it is much easier to always use the GCM specific polynomial for now.
 class Polynomial {
+  /// @brief pshufb mask reversing the order of the 16 bytes
+  static inline const __m128i BYTE_REVERSE =
+      _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+
 public:
   /// @brief construct a new Polynomial over F_(2^128) from a list of factors in
   /// GCM convention (i.e. reversed)
@@ -29,7 +47,21 @@ public:
   /// @param high factors 0 to 63
   /// @param low factors 64 to 127
   Polynomial(const std::uint64_t high, const std::uint64_t low)
-      : m_polynomial(_mm_setr_epi64(_mm_set_pi64x(low), _mm_set_pi64x(high))) {}
+      : m_polynomial(_mm_set_epi64x(high, low)) {}
+
+  /// @brief convert from the generic field type, which has the same layout
+  explicit Polynomial(const Field &field)
+      : Polynomial(field.limbs()[1], field.limbs()[0]) {}
+
+  /// @brief convert to the generic field type, which has the same layout
+  Field to_field() const {
+    return Field({static_cast<std::uint64_t>(_mm_cvtsi128_si64(m_polynomial)),
+                  static_cast<std::uint64_t>(
+                      _mm_extract_epi64(m_polynomial, 1))});
+  }
+
+  /// @brief the factors in the layout of the constructor, for the kernels
+  __m128i to_m128i() const { return m_polynomial; }
 
   static Polynomial one() { return Polynomial(1llu << 63, 0); }
 
@@ -41,47 +73,131 @@ public:
   /// [0]'s MSB represents the factor of x^0, \p gcm_bytes[0]'s LSB
   /// represents the factor of x^7, and so on.
   /// @return the constructed Polynomial
+  static Polynomial from_gcm_bytes(std::span<const std::uint8_t, 16> gcm_bytes) {
+    // The GCM byte order is the reverse of the little endian register order
+    __m128i x = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(gcm_bytes.data()));
+    return Polynomial(_mm_shuffle_epi8(x, BYTE_REVERSE));
+  }
+
+  /// @brief see from_gcm_bytes(std::span<const std::uint8_t, 16>)
+  /// @param gcm_bytes exactly 16 bytes
   static Polynomial from_gcm_bytes(const std::vector<std::uint8_t> &gcm_bytes);
 
   /// @brief construct a new Polynomial over F_(2^128) from a set of exponents.
   /// @param exponents the polynomial will have a 1 as a factor at every index
-  /// specified in this vector.
+  /// specified in this span.
   /// @return the constructed Polynomial
-  static Polynomial from_exponents(const std::vector<std::uint8_t> &exponents);
+  static Polynomial from_exponents(std::span<const std::uint8_t> exponents);
 
-  // FIXME: These conversion functions return std::vector<std::uint8_t>.
-  // This is mostly done for compatibility with the JSON parsing, but
-  // breaks the abstraction that this code is just a "library" being used by the
-  // glue code. Instead, `to_gcm_bytes` and `to_exponents` should return a
-  // std::array<16, std::uint8_t> and std::set<std::uint8_t> respectively.
+  /// @brief see from_exponents(std::span<const std::uint8_t>)
+  static Polynomial from_exponents(const std::vector<std::uint8_t> &exponents) {
+    return from_exponents(std::span(exponents));
+  }
 
   /// @brief convert the Polynomial to a representation as specified in NIST
   /// Special Publication 800-38D, page 12.
-  /// @return the factors for the polynomial. gcm_bytes[0]'s MSB represents the
-  /// factor of x^0, gcm_bytes[0]'s LSB represents the factor of x^7, and so on.
-  std::vector<std::uint8_t> to_gcm_bytes();
+  /// @param out the factors for the polynomial. out[0]'s MSB represents the
+  /// factor of x^0, out[0]'s LSB represents the factor of x^7, and so on.
+  void to_gcm_bytes(std::span<std::uint8_t, 16> out) const {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out.data()),
+                     _mm_shuffle_epi8(m_polynomial, BYTE_REVERSE));
+  }
+
+  /// @brief see to_gcm_bytes(std::span<std::uint8_t, 16>)
+  std::array<std::uint8_t, 16> to_gcm_block() const {
+    std::array<std::uint8_t, 16> block;
+    this->to_gcm_bytes(block);
+    return block;
+  }
+
+  /// @brief see to_gcm_bytes(std::span<std::uint8_t, 16>)
+  std::vector<std::uint8_t> to_gcm_bytes() const {
+    std::array<std::uint8_t, 16> block = this->to_gcm_block();
+    return std::vector<std::uint8_t>(block.begin(), block.end());
+  }
 
   /// @brief convert the Polynomial to the list of exponents.
-  /// @return the polynomial has a 1 as a factor at every index
-  /// specified in this vector.
+  /// @param out receives the exponents with a 1 as a factor, in ascending
+  /// order
+  /// @return the number of exponents written to \p out
+  std::size_t to_exponents(std::span<std::uint8_t, 128> out) const;
+
+  /// @brief see to_exponents(std::span<std::uint8_t, 128>)
   std::vector<std::uint8_t> to_exponents() const;
 
   Polynomial pow(__m128i exponent) const;
 
-  Polynomial modular_inverse() const {
-    return this->pow(
-        _mm_setr_epi32(0xfffffffe, 0xffffffff, 0xffffffff, 0xffffffff));
-  }
-
-  /// @brief generate a random polynomial in GF_(2^128)
+  /// @brief calculate x^2. Squaring is linear in characteristic 2, so this is
+  /// cheaper than a general multiplication.
+  Polynomial square() const { return Polynomial(Backend::square(m_polynomial)); }
+
+  /// @brief calculate the Frobenius map x^(2^ \p k ). Up to
+  /// FROBENIUS_TABLE_THRESHOLD this squares repeatedly; beyond that, it applies
+  /// a precomputed 128x128 bit matrix. The matrices used by modular_inverse()
+  /// are computed at compile time, all others on first use of each k.
+  /// @param k the number of squarings, taken modulo 128
+  Polynomial frobenius(std::size_t k) const;
+
+  /// @brief calculate the multiplicative inverse `x^(2^128 - 2)` with the
+  /// Itoh-Tsujii addition chain, i.e. with 12 multiplications and 127
+  /// squarings instead of the ~254 multiplications of pow().
+  /// @return the inverse, or zero for zero
+  Polynomial modular_inverse() const;
+
+  /// @brief invert every element of \p a using Montgomery's trick: a single
+  /// modular_inverse() plus three multiplications per element. Zero elements
+  /// are mapped to zero and do not affect the others.
+  /// @param a the elements to invert
+  /// @param out the inverses, same size as \p a . May alias \p a .
+  static void modular_inverse(std::span<const Polynomial> a,
+                              std::span<Polynomial> out);
+
+  /// @brief generate a random polynomial in GF_(2^128) with the calling
+  /// thread's Random::generator(), so it is thread-safe and reproducible after
+  /// Random::seed()
   /// @return a polynomial with each exponent appearing with roughly 50%
   /// probability.
   static Polynomial random();
 
+  /// @brief fill \p out with random polynomials, drawing the words from the
+  /// generator in bulk
+  /// @param out the polynomials to overwrite
+  static void random(std::span<Polynomial> out);
+
+  // The batch functions below use the widest CLMUL::Kernels supported by the
+  // host.
+
+  /// @brief multiply \p a [i] by \p b [i] for every index
+  /// @param a the left factors
+  /// @param b the right factors, same size as \p a
+  /// @param out the products, same size as \p a . May alias \p a or \p b .
+  static void multiply(std::span<const Polynomial> a,
+                       std::span<const Polynomial> b, std::span<Polynomial> out);
+
+  /// @brief multiply every element of \p a by \p scalar
+  /// @param a the left factors
+  /// @param scalar the right factor
+  /// @param out the products, same size as \p a . May alias \p a .
+  static void multiply(std::span<const Polynomial> a, const Polynomial &scalar,
+                       std::span<Polynomial> out);
+
+  /// @brief calculate the sum of \p a [i] * \p b [i]. The wide products are
+  /// summed up unreduced, so there is only a single reduction in total.
+  /// @param a the left factors
+  /// @param b the right factors, same size as \p a
+  /// @return the sum of the products
+  static Polynomial dot(std::span<const Polynomial> a,
+                        std::span<const Polynomial> b);
+
   Polynomial &operator+=(const Polynomial &rhs);
-  Polynomial &operator*=(const Polynomial &rhs);
   Polynomial &operator/=(const Polynomial &rhs);
 
+  Polynomial &operator*=(const Polynomial &rhs) {
+    m_polynomial = Backend::multiply(m_polynomial, rhs.m_polynomial);
+    return *this;
+  }
+
   friend inline bool operator==(const Polynomial &lhs, const Polynomial &rhs) {
     __m128i diff = _mm_xor_si128(lhs.m_polynomial, rhs.m_polynomial);
     return _mm_test_all_zeros(diff, diff);
@@ -116,8 +232,8 @@ public:
     return lhs;
   }
 
-  friend std::ostream &operator<<(std::ostream &os, Polynomial &poly) {
-    return os << cppcodec::base64_rfc4648::encode(poly.to_gcm_bytes());
+  friend std::ostream &operator<<(std::ostream &os, const Polynomial &poly) {
+    return os << cppcodec::base64_rfc4648::encode(poly.to_gcm_block());
   }
 
 private:
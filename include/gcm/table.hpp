@@ -0,0 +1,65 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <emmintrin.h>
+
+/**
+ * @brief Portable table-driven GF(2^128) multiplication in GCM convention,
+ * for hosts without PCLMULQDQ.
+ *
+ * This is Shoup's method as described in the GCM specification (McGrew and
+ * Viega, section 4.1): the multiples of one factor by every 4-bit (or 8-bit)
+ * polynomial are precomputed, and the other factor is consumed one nibble (or
+ * byte) at a time, multiplying the partial product by x^4 (or x^8) between
+ * steps. The bits shifted out on each step are reduced with a small constant
+ * table.
+ *
+ * An element is handled as two 64-bit halves in the same order as
+ * GCM::Polynomial's __m128i: `high` holds the factors of x^0 to x^63 from the
+ * MSB down, `low` the factors of x^64 to x^127.
+ */
+namespace GCM::Table {
+
+/// @brief an element as two 64-bit halves
+struct Halves {
+  std::uint64_t high;
+  std::uint64_t low;
+};
+
+/// @brief the multiples of a fixed factor by all polynomials of degree < 8.
+/// Multiplying by it takes 16 table lookups, which makes it the fast path for
+/// GHASH with a fixed auth key. It takes 4 KiB.
+class Key {
+public:
+  /// @brief precompute the multiples of \p h
+  explicit Key(__m128i h);
+
+  /// @brief calculate \p x * h
+  __m128i multiply(__m128i x) const;
+
+private:
+  /// @brief m_multiples[b] is h multiplied by the polynomial whose factors of
+  /// x^0 to x^7 are the bits of b from the MSB down
+  std::array<Halves, 256> m_multiples;
+};
+
+/// @brief multiply two field elements with a 4-bit table of \p b built on the
+/// fly
+__m128i multiply(__m128i a, __m128i b);
+
+/// @brief square a field element
+__m128i square(__m128i a);
+
+// GCM::CLMUL::Kernels for hosts without PCLMULQDQ. scale_kernel builds one
+// Key for the scalar. ghash_kernel builds one for `H`, the last of the
+// powers, and applies Horner's rule block by block.
+
+void multiply_kernel(const __m128i *a, const __m128i *b, __m128i *out,
+                     std::size_t count);
+void scale_kernel(const __m128i *a, __m128i scalar, __m128i *out,
+                  std::size_t count);
+__m128i dot_kernel(const __m128i *a, const __m128i *b, std::size_t count);
+__m128i ghash_kernel(__m128i tag, const std::uint8_t *data, std::size_t count,
+                     const __m128i *powers);
+
+} // namespace GCM::Table
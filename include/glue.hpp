@@ -9,12 +9,17 @@ typedef std::function<nlohmann::json(const nlohmann::json &)> glue_function;
 const std::map<std::string, Glue::glue_function> ACTIONS = {
     {"noop", Actions::noop},
     {"bytenigma", Actions::bytenigma},
+    {"bytenigma-stream", Actions::bytenigma_stream},
+    {"bytenigma-search", Actions::bytenigma_search},
+    {"bytenigma-batch", Actions::bytenigma_batch},
     {"padding-oracle-server", Actions::padding_oracle_server},
     {"padding-oracle-attack", Actions::padding_oracle_attack},
     {"gcm-block2poly", Actions::gcm_block2poly},
     {"gcm-poly2block", Actions::gcm_poly2block},
     {"gcm-clmul", Actions::gcm_clmul},
+    {"gcm-clmul-batch", Actions::gcm_clmul_batch},
     {"gcm-encrypt", Actions::aes_128_gcm_encrypt},
+    {"gcm-decrypt-stream", Actions::aes_128_gcm_decrypt_stream},
     {"cantor-zassenhaus", Actions::cantor_zassenhaus},
     {"gcm-recover", Actions::gcm_recover},
     {"gcm-poly-add", Actions::gcm_poly_add},
@@ -1,7 +1,7 @@
 #pragma once
 #include <nlohmann/json.hpp>
 
-#ifndef TEST
+#if !defined(TEST) && !defined(BENCH)
 int main(int argc, char *argv[]);
 #endif
 nlohmann::json parse(int argc, char *argv[]);
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+
+/**
+ * @brief Helpers for splitting independent work across threads.
+ */
+namespace Parallel {
+
+/// @brief the number of worker threads to use by default, i.e. the number of
+/// hardware threads (at least 1)
+/// @return the thread count
+std::size_t default_threads();
+
+/// @brief call \p task once for every index in `[0, count)` on a pool of \p
+/// threads worker threads. Each worker repeatedly claims the next unprocessed
+/// index, so uneven tasks are balanced automatically.
+/// @param count the number of tasks
+/// @param task the function to call with each index
+/// @param threads the number of worker threads. With 1 thread, all tasks run
+/// on the calling thread.
+/// @throws the first exception thrown by any task, after all workers have
+/// finished
+void for_each_index(std::size_t count,
+                    const std::function<void(std::size_t)> &task,
+                    std::size_t threads = default_threads());
+
+} // namespace Parallel
@@ -0,0 +1,80 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+/**
+ * @brief Fast, seedable pseudo random numbers for the randomized algorithms.
+ *
+ * Every thread draws from its own xoshiro256** generator, so random elements
+ * can be generated concurrently without locking. All generators derive from
+ * one process-wide seed: the n-th thread to draw numbers after Random::seed()
+ * uses the base stream advanced by n jumps of 2^128 outputs, so the streams of
+ * different threads never overlap. Without an explicit seed, the base seed is
+ * taken from std::random_device.
+ *
+ * This is not a cryptographically secure generator. It is meant for
+ * Cantor-Zassenhaus splitting and for tests and benchmarks, where speed and
+ * reproducibility matter.
+ */
+namespace Random {
+
+/// @brief the xoshiro256** generator by Blackman and Vigna, as a
+/// UniformRandomBitGenerator
+class Xoshiro256 {
+public:
+  using result_type = std::uint64_t;
+
+  /// @brief seed the generator by expanding \p seed with SplitMix64, as
+  /// recommended by the authors
+  explicit Xoshiro256(std::uint64_t seed);
+
+  /// @brief start from the raw \p state , which must not be all zeros
+  explicit Xoshiro256(const std::array<std::uint64_t, 4> &state)
+      : m_state(state) {}
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  /// @brief the next output
+  result_type operator()() {
+    const std::uint64_t result = std::rotl(m_state[1] * 5, 7) * 9;
+    const std::uint64_t t = m_state[1] << 17;
+    m_state[2] ^= m_state[0];
+    m_state[3] ^= m_state[1];
+    m_state[1] ^= m_state[2];
+    m_state[0] ^= m_state[3];
+    m_state[2] ^= t;
+    m_state[3] = std::rotl(m_state[3], 45);
+    return result;
+  }
+
+  /// @brief fill \p out with the next outputs
+  void fill(std::span<std::uint64_t> out) {
+    for (std::uint64_t &word : out) {
+      word = (*this)();
+    }
+  }
+
+  /// @brief advance by 2^128 outputs, which starts a new non-overlapping
+  /// stream
+  void jump();
+
+private:
+  std::array<std::uint64_t, 4> m_state;
+};
+
+/// @brief reseed all generators from \p seed . The calling thread starts over
+/// with the first stream, and every other thread picks up a new stream on its
+/// next call to generator().
+void seed(std::uint64_t seed);
+
+/// @brief the generator of the calling thread
+/// @return a reference which is valid until the thread exits
+Xoshiro256 &generator();
+
+} // namespace Random
@@ -19,7 +19,7 @@ inline __m128i from_index(std::uint8_t index) {
     high = 1llu << (index - 64);
   else
     low = 1llu << index;
-  return _mm_setr_epi64(_mm_set_pi64x(low), _mm_set_pi64x(high));
+  return _mm_set_epi64x(high, low);
 }
 
 /// @brief test if index \p index of \p x is set.
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <span>
+
+/**
+ * @brief Helpers for processing streams which may not fit into memory.
+ */
+namespace Stream {
+
+/// @brief the number of bytes read, transformed and written at a time by
+/// Stream::transform. Large enough for Bytenigma to split a chunk across
+/// several threads.
+constexpr std::size_t CHUNK_SIZE = 4 << 20;
+
+typedef std::function<void(std::span<const std::uint8_t>,
+                           std::span<std::uint8_t>)>
+    chunk_transform;
+
+/// @brief read everything from \p input , one CHUNK_SIZE chunk at a time,
+/// pass each chunk through \p transform and write the result to \p output .
+/// The memory use does not depend on the length of the stream.
+/// @param input the stream to read from
+/// @param output the stream to write to
+/// @param transform called with each chunk and an output buffer of the same
+/// size, in stream order. The last chunk may be shorter, or empty.
+/// @return the number of bytes processed
+/// @throws std::runtime_error if reading or writing fails
+std::uint64_t transform(std::istream &input, std::ostream &output,
+                        const chunk_transform &transform);
+
+} // namespace Stream
@@ -1,10 +1,14 @@
 #include <botan/block_cipher.h>
+#include <filesystem>
+#include <fstream>
 #include <nlohmann/json.hpp>
 #include <ranges>
+#include <stdexcept>
 #include <vector>
 
 #include "actions.hpp"
 #include "cppcodec/base64_rfc4648.hpp"
+#include "gcm/decryptor.hpp"
 #include "gcm/encryptor.hpp"
 
 using json = nlohmann::json;
@@ -19,9 +23,7 @@ json Actions::aes_128_gcm_encrypt(const json &input) {
   std::vector<std::uint8_t> plaintext =
       cppcodec::base64_rfc4648::decode(input["plaintext"].get<std::string>());
 
-  auto aes = Botan::BlockCipher::create_or_throw("AES-128");
-  aes->set_key(key);
-  GCM::Encryptor e = GCM::Encryptor(associated_data, std::move(aes), nonce);
+  GCM::Encryptor e = GCM::Encryptor(associated_data, key, nonce);
   std::vector<std::uint8_t> ciphertext = e.update(plaintext);
   std::vector<std::uint8_t> auth_tag = e.finalize();
 
@@ -30,3 +32,56 @@ json Actions::aes_128_gcm_encrypt(const json &input) {
                {"Y0", cppcodec::base64_rfc4648::encode(e.y0())},
                {"H", cppcodec::base64_rfc4648::encode(e.h())}});
 }
+
+json Actions::aes_128_gcm_decrypt_stream(const json &input) {
+  std::vector<std::uint8_t> key =
+      cppcodec::base64_rfc4648::decode(input["key"].get<std::string>());
+  std::vector<std::uint8_t> nonce =
+      cppcodec::base64_rfc4648::decode(input["nonce"].get<std::string>());
+  std::vector<std::uint8_t> associated_data = cppcodec::base64_rfc4648::decode(
+      input["associated_data"].get<std::string>());
+  std::vector<std::uint8_t> auth_tag =
+      cppcodec::base64_rfc4648::decode(input["auth_tag"].get<std::string>());
+
+  auto aes = Botan::BlockCipher::create_or_throw("AES-128");
+  aes->set_key(key);
+  GCM::Decryptor d = GCM::Decryptor(associated_data, std::move(aes), nonce);
+
+  auto input_path = input["input_file"].get<std::string>();
+  std::ifstream input_file(input_path, std::ios::binary);
+  if (!input_file.is_open()) {
+    throw std::runtime_error("Could not open input file " + input_path);
+  }
+  // The plaintext is unauthenticated until the whole ciphertext has been
+  // read, so it is written to a temporary file next to the output file and
+  // only renamed to the output file once the auth tag is valid.
+  std::filesystem::path output_path = input["output_file"].get<std::string>();
+  std::filesystem::path temporary_path = output_path;
+  temporary_path += ".part";
+  std::uint64_t processed;
+  bool authentic;
+  try {
+    std::ofstream output_file(temporary_path,
+                              std::ios::binary | std::ios::trunc);
+    if (!output_file.is_open()) {
+      throw std::runtime_error("Could not open output file " +
+                               temporary_path.string());
+    }
+    processed = d.process_stream(input_file, output_file);
+    output_file.close();
+    if (!output_file) {
+      throw std::runtime_error("Failed to write the output stream");
+    }
+    authentic = d.verify(auth_tag);
+  } catch (...) {
+    std::filesystem::remove(temporary_path);
+    throw;
+  }
+
+  if (authentic) {
+    std::filesystem::rename(temporary_path, output_path);
+  } else {
+    std::filesystem::remove(temporary_path);
+  }
+  return json({{"authentic", authentic}, {"processed", processed}});
+}
@@ -1,7 +1,11 @@
+#include <fstream>
 #include <nlohmann/json.hpp>
+#include <stdexcept>
 
 #include "actions.hpp"
 #include "bytenigma.hpp"
+#include "bytenigma/batch.hpp"
+#include "bytenigma/search.hpp"
 #include "cppcodec/base64_rfc4648.hpp"
 
 using json = nlohmann::json;
@@ -14,4 +18,130 @@ json Actions::bytenigma(const json &input) {
   std::vector<std::uint8_t> raw_output = bytenigma.process_bytes(raw_input);
   json output = {{"output", cppcodec::base64_rfc4648::encode(raw_output)}};
   return output;
-}
\ No newline at end of file
+}
+json Actions::bytenigma_stream(const json &input) {
+  auto rotors = input["rotors"].get<std::vector<std::vector<std::uint8_t>>>();
+  auto positions = std::vector<std::uint8_t>();
+  if (input.contains("positions")) {
+    positions = input["positions"].get<std::vector<std::uint8_t>>();
+  }
+  Bytenigma::Bytenigma bytenigma = Bytenigma::Bytenigma(rotors, positions);
+
+  auto input_path = input["input_file"].get<std::string>();
+  std::ifstream input_file(input_path, std::ios::binary);
+  if (!input_file.is_open()) {
+    throw std::runtime_error("Could not open input file " + input_path);
+  }
+  // When resuming a stream, the output of this invocation is appended to the
+  // output of the previous one.
+  auto output_path = input["output_file"].get<std::string>();
+  std::ios::openmode mode = std::ios::binary;
+  mode |= input.value("append", false) ? std::ios::app : std::ios::trunc;
+  std::ofstream output_file(output_path, mode);
+  if (!output_file.is_open()) {
+    throw std::runtime_error("Could not open output file " + output_path);
+  }
+
+  std::uint64_t processed = bytenigma.process_stream(input_file, output_file);
+  json output = {{"processed", processed},
+                 {"positions", bytenigma.positions()}};
+  return output;
+}
+
+json Actions::bytenigma_search(const json &input) {
+  auto rotors = input["rotors"].get<std::vector<std::vector<std::uint8_t>>>();
+  std::vector<std::uint8_t> plaintext =
+      cppcodec::base64_rfc4648::decode(input["plaintext"].get<std::string>());
+  std::vector<std::uint8_t> ciphertext =
+      cppcodec::base64_rfc4648::decode(input["ciphertext"].get<std::string>());
+  auto matches = Bytenigma::find_positions(
+      Bytenigma::RotorTables::cached(rotors), plaintext, ciphertext);
+  json output = {{"positions", matches}};
+  return output;
+}
+
+json Actions::bytenigma_batch(const json &input) {
+  const json &messages = input["messages"];
+  auto contexts = std::vector<std::shared_ptr<const Bytenigma::RotorTables>>();
+  auto inputs = std::vector<std::vector<std::uint8_t>>();
+  auto outputs = std::vector<std::vector<std::uint8_t>>();
+  auto positions = std::vector<std::vector<std::uint8_t>>();
+  for (const json &message : messages) {
+    // Messages with the same rotors share one context, and thereby the
+    // composed tables in process_batch.
+    contexts.push_back(Bytenigma::RotorTables::cached(
+        message["rotors"].get<std::vector<std::vector<std::uint8_t>>>()));
+    inputs.push_back(
+        cppcodec::base64_rfc4648::decode(message["input"].get<std::string>()));
+    outputs.emplace_back(inputs.back().size());
+    if (message.contains("positions")) {
+      positions.push_back(message["positions"].get<std::vector<std::uint8_t>>());
+    } else {
+      positions.emplace_back(contexts.back()->size());
+    }
+    if (positions.back().size() != contexts.back()->size()) {
+      throw std::invalid_argument("Expected one rotor position per rotor");
+    }
+  }
+
+  auto batch = std::vector<Bytenigma::Message>();
+  for (std::size_t i = 0; i < inputs.size(); ++i) {
+    batch.push_back({contexts[i].get(), positions[i], inputs[i], outputs[i]});
+  }
+  Bytenigma::process_batch(batch);
+
+  json output = {{"outputs", json::array()}};
+  for (std::size_t i = 0; i < outputs.size(); ++i) {
+    output["outputs"].push_back(
+        {{"output", cppcodec::base64_rfc4648::encode(outputs[i])},
+         {"positions", positions[i]}});
+  }
+  return output;
+}
+
+#ifdef TEST
+#include <filesystem>
+#include <iterator>
+
+#include "bytenigma/testing.hpp"
+#include "doctest.h"
+
+TEST_CASE("test bytenigma-stream writes the output of the bytenigma action") {
+  auto rotors = Bytenigma::Testing::random_rotors(3, 5);
+  std::vector<std::uint8_t> plaintext(70000);
+  for (std::size_t i = 0; i < plaintext.size(); ++i) {
+    plaintext[i] = i ^ (i >> 9);
+  }
+  std::filesystem::path directory = std::filesystem::temp_directory_path();
+  std::filesystem::path input_path = directory / "kauma_bytenigma_test.in";
+  std::filesystem::path output_path = directory / "kauma_bytenigma_test.out";
+  std::ofstream(input_path, std::ios::binary)
+      .write(reinterpret_cast<const char *>(plaintext.data()),
+             plaintext.size());
+
+  // Encrypt the file twice in a row, the second time resuming from the
+  // positions of the first and appending to its output.
+  json request = {{"rotors", rotors},
+                  {"input_file", input_path.string()},
+                  {"output_file", output_path.string()}};
+  json first = Actions::bytenigma_stream(request);
+  request["positions"] = first["positions"];
+  request["append"] = true;
+  json second = Actions::bytenigma_stream(request);
+  CHECK(second["processed"] == plaintext.size());
+
+  std::vector<std::uint8_t> twice = plaintext;
+  twice.insert(twice.end(), plaintext.begin(), plaintext.end());
+  json expected = Actions::bytenigma(
+      {{"rotors", rotors},
+       {"input", cppcodec::base64_rfc4648::encode(twice)}});
+
+  std::ifstream output_file(output_path, std::ios::binary);
+  std::vector<std::uint8_t> actual((std::istreambuf_iterator<char>(output_file)),
+                                   std::istreambuf_iterator<char>());
+  CHECK(actual == cppcodec::base64_rfc4648::decode(
+                      expected["output"].get<std::string>()));
+  std::filesystem::remove(input_path);
+  std::filesystem::remove(output_path);
+}
+#endif
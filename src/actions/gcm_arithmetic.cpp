@@ -1,6 +1,8 @@
+#include <array>
 #include <emmintrin.h>
 #include <nlohmann/json.hpp>
 #include <smmintrin.h>
+#include <span>
 #include <stdexcept>
 #include <vector>
 
@@ -16,7 +18,9 @@ json Actions::gcm_block2poly(const json &input) {
   std::vector<std::uint8_t> gcm_bytes =
       cppcodec::base64_rfc4648::decode(input["block"].get<std::string>());
   auto poly = GCM::Polynomial::from_gcm_bytes(gcm_bytes);
-  return json({{"exponents", poly.to_exponents()}});
+  std::array<std::uint8_t, 128> exponents;
+  std::size_t count = poly.to_exponents(exponents);
+  return json({{"exponents", std::span(exponents).first(count)}});
 }
 
 json Actions::gcm_poly2block(const json &input) {
@@ -24,7 +28,7 @@ json Actions::gcm_poly2block(const json &input) {
       input["exponents"].get<std::vector<std::uint8_t>>();
   auto poly = GCM::Polynomial::from_exponents(exponents);
   return json(
-      {{"block", cppcodec::base64_rfc4648::encode(poly.to_gcm_bytes())}});
+      {{"block", cppcodec::base64_rfc4648::encode(poly.to_gcm_block())}});
 }
 
 json Actions::gcm_clmul(const json &input) {
@@ -37,7 +41,29 @@ json Actions::gcm_clmul(const json &input) {
   auto b = GCM::Polynomial::from_gcm_bytes(b_bytes);
 
   return json({{"a_times_b",
-                cppcodec::base64_rfc4648::encode((a * b).to_gcm_bytes())}});
+                cppcodec::base64_rfc4648::encode((a * b).to_gcm_block())}});
+}
+
+json Actions::gcm_clmul_batch(const json &input) {
+  auto a = std::vector<GCM::Polynomial>();
+  auto b = std::vector<GCM::Polynomial>();
+  for (const json &pair : input["pairs"]) {
+    a.push_back(GCM::Polynomial::from_gcm_bytes(
+        cppcodec::base64_rfc4648::decode(pair["a"].get<std::string>())));
+    b.push_back(GCM::Polynomial::from_gcm_bytes(
+        cppcodec::base64_rfc4648::decode(pair["b"].get<std::string>())));
+  }
+
+  auto products = std::vector<GCM::Polynomial>(a.size(), GCM::Polynomial::zero());
+  GCM::Polynomial::multiply(a, b, products);
+  json output = {{"a_times_b", json::array()}};
+  for (GCM::Polynomial &product : products) {
+    output["a_times_b"].push_back(
+        cppcodec::base64_rfc4648::encode(product.to_gcm_block()));
+  }
+  output["sum"] = cppcodec::base64_rfc4648::encode(
+      GCM::Polynomial::dot(a, b).to_gcm_block());
+  return output;
 }
 
 json Actions::gcm_poly_add(const json &input) {
@@ -103,7 +129,6 @@ json Actions::gcm_poly_powmod(const json &input) {
         "Exponent is not an unsigned integer. Is it too large?\n");
   }
   std::uint64_t exponent_low = input["exponent"].get<std::uint64_t>();
-  __m128i exponent =
-      _mm_setr_epi64(_mm_set_pi64x(exponent_low), _mm_set_pi64x(0));
+  __m128i exponent = _mm_set_epi64x(0, exponent_low);
   return json({{"result", (base.pow(exponent, modulo)).to_json()}});
 }
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "random.hpp"
+
+/// @brief the registered benchmark cases. This is a function-local static so
+/// that registration from static initializers in other translation units is
+/// independent of the initialization order.
+static std::vector<std::pair<std::string, Benchmark::benchmark_case>> &
+registry() {
+  static std::vector<std::pair<std::string, Benchmark::benchmark_case>> cases;
+  return cases;
+}
+
+int Benchmark::register_case(const std::string &name,
+                             Benchmark::benchmark_case function) {
+  registry().emplace_back(name, std::move(function));
+  return 0;
+}
+
+int Benchmark::run_all() {
+  for (const auto &[name, function] : registry()) {
+    std::cout << "[" << name << "]" << std::endl;
+    // Every case sees the same random inputs on every run
+    Random::seed(0);
+    function();
+  }
+  return 0;
+}
+
+double Benchmark::throughput(const std::string &name, std::size_t bytes,
+                             const std::function<void()> &function) {
+  using clock = std::chrono::steady_clock;
+  // Warm up caches and branch predictors before measuring.
+  function();
+
+  std::size_t iterations = 0;
+  const clock::time_point start = clock::now();
+  clock::duration elapsed;
+  do {
+    function();
+    ++iterations;
+    elapsed = clock::now() - start;
+  } while (elapsed < std::chrono::milliseconds(500));
+
+  double seconds = std::chrono::duration<double>(elapsed).count();
+  double bytes_per_second = static_cast<double>(bytes * iterations) / seconds;
+  std::cout << "  " << std::left << std::setw(32) << name << std::right
+            << std::fixed << std::setprecision(3) << std::setw(10)
+            << bytes_per_second / 1e9 << " GB/s" << std::endl;
+  return bytes_per_second;
+}
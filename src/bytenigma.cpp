@@ -1,14 +1,26 @@
 #include <cstdint>
 #include <ranges>
+#include <stdexcept>
 #include <vector>
 
 #include "bytenigma.hpp"
+#include "stream.hpp"
 
 Bytenigma::Bytenigma::Bytenigma(
-    const std::vector<std::vector<std::uint8_t>> &rotors)
-    : m_rotors(rotors), m_inv_rotors() {
-  m_rotor_positions = std::vector<std::uint8_t>(rotors.size());
-  this->calculate_inverse_rotors();
+    const std::vector<std::vector<std::uint8_t>> &rotors,
+    const std::vector<std::uint8_t> &positions)
+    : Bytenigma(RotorTables::cached(rotors), positions) {}
+
+Bytenigma::Bytenigma::Bytenigma(std::shared_ptr<const RotorTables> context,
+                                const std::vector<std::uint8_t> &positions)
+    : m_context(std::move(context)),
+      m_initial_positions(positions.empty()
+                              ? std::vector<std::uint8_t>(m_context->size())
+                              : positions),
+      m_rotor_positions(m_initial_positions) {
+  if (m_initial_positions.size() != m_context->size()) {
+    throw std::invalid_argument("Expected one rotor position per rotor");
+  }
 }
 
 std::uint8_t Bytenigma::Bytenigma::process_byte(std::uint8_t input) {
@@ -20,30 +32,57 @@ std::uint8_t Bytenigma::Bytenigma::process_byte(std::uint8_t input) {
 }
 
 std::vector<std::uint8_t>
-Bytenigma::Bytenigma::process_bytes(const std::vector<std::uint8_t> &input) {
+Bytenigma::Bytenigma::process_bytes(const std::vector<std::uint8_t> &input,
+                                    std::size_t threads) {
   auto output = std::vector<std::uint8_t>(input.size());
-  for (std::size_t i : std::views::iota(0u, input.size())) {
-    output.at(i) = (this->process_byte(input.at(i)));
-  }
+  ::Bytenigma::process_parallel(*m_context, m_rotor_positions, input, output,
+                                threads);
   return output;
 }
 
+void Bytenigma::Bytenigma::process_bytes(std::span<const std::uint8_t> input,
+                                         std::span<std::uint8_t> output,
+                                         std::size_t threads) {
+  ::Bytenigma::process_parallel(*m_context, m_rotor_positions, input, output,
+                                threads);
+}
+
+std::uint64_t Bytenigma::Bytenigma::process_stream(std::istream &input,
+                                                   std::ostream &output) {
+  return Stream::transform(input, output,
+                           [this](std::span<const std::uint8_t> plaintext,
+                                  std::span<std::uint8_t> ciphertext) {
+                             this->process_bytes(plaintext, ciphertext);
+                           });
+}
+
+std::vector<std::uint8_t>
+Bytenigma::Bytenigma::state_at(std::uint64_t offset) const {
+  std::vector<std::uint8_t> positions = m_initial_positions;
+  ::Bytenigma::advance(*m_context, positions, offset);
+  return positions;
+}
+
+void Bytenigma::Bytenigma::seek(std::uint64_t offset) {
+  m_rotor_positions = this->state_at(offset);
+}
+
 std::uint8_t Bytenigma::Bytenigma::forward_pass(std::uint8_t input) {
-  for (std::size_t i : std::views::iota(0u, m_rotors.size())) {
-    const std::vector<std::uint8_t> &rotor = m_rotors.at(i);
+  for (std::size_t i : std::views::iota(0u, m_context->size())) {
+    const std::uint8_t *rotor = m_context->forward(i);
     std::uint8_t position = m_rotor_positions[i];
-    input = rotor.at((input + position) % rotor.size());
+    input = rotor[(input + position) % ROTOR_SIZE];
   }
   return input;
 }
 
 std::uint8_t Bytenigma::Bytenigma::backward_pass(std::uint8_t input) {
-  // Walk backwards through the m_inv_rotors list (starting with rotor `n`)
+  // Walk backwards through the inverse rotors (starting with rotor `n`)
   for (std::size_t i :
-       std::views::iota(0u, m_inv_rotors.size()) | std::views::reverse) {
-    const std::vector<std::uint8_t> &rotor = m_inv_rotors.at(i);
+       std::views::iota(0u, m_context->size()) | std::views::reverse) {
+    const std::uint8_t *rotor = m_context->inverse(i);
     std::uint8_t position = m_rotor_positions[i];
-    input = rotor.at((input) % rotor.size());
+    input = rotor[input];
 
     // Underflow is well-defined behavior:
     // > Unsigned integers shall obey the laws of arithmetic modulo 2n where n
@@ -57,29 +96,22 @@ std::uint8_t Bytenigma::Bytenigma::backward_pass(std::uint8_t input) {
 void Bytenigma::Bytenigma::turn_rotor(const std::size_t &index) {
   // Recursively turn the rotor at `index` and all rotors to the right of it as
   // long as an overflow occurs
-  const std::vector<std::uint8_t> &rotor = m_rotors.at(index);
   std::size_t old_position = m_rotor_positions.at(index);
-  m_rotor_positions.at(index) = (old_position + 1) % rotor.size();
+  m_rotor_positions.at(index) = (old_position + 1) % ROTOR_SIZE;
 
   // check if we also need to rotate the next rotor by checking
   // if the top-most element is currently a 0
-  if (rotor.at(old_position) == 0 && (index + 1) < m_rotors.size()) {
+  if (old_position == m_context->carry_position(index) &&
+      (index + 1) < m_context->size()) {
     this->turn_rotor(index + 1);
   };
 }
 
-void Bytenigma::Bytenigma::calculate_inverse_rotors() {
-  m_inv_rotors = std::vector<std::vector<std::uint8_t>>(m_rotors.size());
-  for (std::size_t i : std::views::iota(0u, m_rotors.size())) {
-    auto inv_rotor = std::vector<std::uint8_t>(m_rotors.at(i).size());
-    for (std::size_t in = 0; in < inv_rotor.size(); ++in) {
-      inv_rotor.at(m_rotors.at(i).at(in)) = static_cast<std::uint8_t>(in);
-    }
-    m_inv_rotors.at(i) = inv_rotor;
-  }
-}
-
 #ifdef TEST
+#include <algorithm>
+#include <sstream>
+
+#include "bytenigma/testing.hpp"
 #include "doctest.h"
 
 TEST_CASE("test bytenigma forward pass") {
@@ -136,7 +168,11 @@ TEST_CASE("test bytenigma inverted rotors are calculated correctly") {
   }
 
   Bytenigma::Bytenigma enigma = Bytenigma::Bytenigma(rotors);
-  CHECK(enigma.m_inv_rotors == inverted_rotors);
+  for (std::size_t i = 0; i < inverted_rotors.size(); ++i) {
+    CHECK(std::ranges::equal(inverted_rotors[i],
+                             std::span(enigma.m_context->inverse(i),
+                                       Bytenigma::ROTOR_SIZE)));
+  }
 }
 
 TEST_CASE("test rotor rotations") {
@@ -161,4 +197,96 @@ TEST_CASE("test rotor rotations") {
   std::vector<std::uint8_t> expected_positions = {1, 1, 1, 0};
   CHECK(enigma.m_rotor_positions == expected_positions);
 }
-#endif
\ No newline at end of file
+
+TEST_CASE("test bytenigma engine matches per-byte processing") {
+  // Cover every unrolled rotor count as well as the dynamic fallback. 70000
+  // bytes are enough for carries to reach the third rotor.
+  for (std::size_t count = 1; count <= 10; ++count) {
+    auto rotors = Bytenigma::Testing::random_rotors(count, count);
+    auto input = std::vector<std::uint8_t>(70000);
+    for (std::size_t i = 0; i < input.size(); ++i) {
+      input[i] = (i * 31) ^ (i >> 8);
+    }
+
+    Bytenigma::Bytenigma reference = Bytenigma::Bytenigma(rotors);
+    auto expected = std::vector<std::uint8_t>();
+    for (std::uint8_t byte : input) {
+      expected.push_back(reference.process_byte(byte));
+    }
+
+    Bytenigma::Bytenigma enigma = Bytenigma::Bytenigma(rotors);
+    CHECK(enigma.process_bytes(input) == expected);
+    CHECK(enigma.m_rotor_positions == reference.m_rotor_positions);
+  }
+}
+
+TEST_CASE("test bytenigma seek matches processing from the start") {
+  auto rotors = Bytenigma::Testing::random_rotors(4, 42);
+  auto input = std::vector<std::uint8_t>(300000);
+  for (std::size_t i = 0; i < input.size(); ++i) {
+    input[i] = i ^ (i >> 11);
+  }
+  Bytenigma::Bytenigma reference = Bytenigma::Bytenigma(rotors);
+  auto expected = reference.process_bytes(input, 1);
+  CHECK(reference.state_at(input.size()) == reference.m_rotor_positions);
+
+  Bytenigma::Bytenigma enigma = Bytenigma::Bytenigma(rotors);
+  for (std::size_t offset : {299999, 70000, 0, 256, 65536}) {
+    enigma.seek(offset);
+    auto tail = std::vector<std::uint8_t>(input.begin() + offset, input.end());
+    CHECK(enigma.process_bytes(tail, 1) ==
+          std::vector<std::uint8_t>(expected.begin() + offset, expected.end()));
+  }
+}
+
+TEST_CASE("test bytenigma stream can be resumed from its positions") {
+  auto rotors = Bytenigma::Testing::random_rotors(3, 7);
+  auto input = std::string(Stream::CHUNK_SIZE + 1000, '\0');
+  for (std::size_t i = 0; i < input.size(); ++i) {
+    input[i] = static_cast<char>(i * 13);
+  }
+  Bytenigma::Bytenigma reference = Bytenigma::Bytenigma(rotors);
+  auto expected = reference.process_bytes(
+      std::vector<std::uint8_t>(input.begin(), input.end()));
+
+  // Encrypt the stream in two invocations, carrying over only the positions
+  std::size_t split = input.size() / 3;
+  std::istringstream first_input(input.substr(0, split));
+  std::ostringstream output;
+  Bytenigma::Bytenigma first = Bytenigma::Bytenigma(rotors);
+  CHECK(first.process_stream(first_input, output) == split);
+
+  std::istringstream second_input(input.substr(split));
+  Bytenigma::Bytenigma second =
+      Bytenigma::Bytenigma(rotors, first.positions());
+  CHECK(second.process_stream(second_input, output) == input.size() - split);
+
+  std::string actual = output.str();
+  CHECK(std::vector<std::uint8_t>(actual.begin(), actual.end()) == expected);
+  CHECK(second.positions() == reference.positions());
+  CHECK_THROWS_AS(Bytenigma::Bytenigma(rotors, {1, 2}), std::invalid_argument);
+}
+
+TEST_CASE("test bytenigma machines share the rotor context") {
+  auto rotors = Bytenigma::Testing::random_rotors(5, 11);
+  Bytenigma::Bytenigma first = Bytenigma::Bytenigma(rotors);
+  Bytenigma::Bytenigma second = Bytenigma::Bytenigma(rotors, {1, 2, 3, 4, 5});
+  CHECK(first.m_context == second.m_context);
+
+  // Messages encrypted from a shared context on several threads give the
+  // same result as independent machines.
+  auto input = std::vector<std::uint8_t>(5000, 0x42);
+  auto expected = Bytenigma::Bytenigma(rotors).process_bytes(input, 1);
+  auto outputs = std::vector<std::vector<std::uint8_t>>(8);
+  Parallel::for_each_index(
+      outputs.size(),
+      [&](std::size_t i) {
+        Bytenigma::Bytenigma machine = Bytenigma::Bytenigma(first.m_context);
+        outputs[i] = machine.process_bytes(input, 1);
+      },
+      4);
+  for (const std::vector<std::uint8_t> &output : outputs) {
+    CHECK(output == expected);
+  }
+}
+#endif
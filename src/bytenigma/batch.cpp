@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "bytenigma/batch.hpp"
+
+void Bytenigma::process_batch(std::span<const Bytenigma::Message> messages) {
+  // Sort by rotor set, then by the positions from the outermost rotor inwards,
+  // so that neighbours differ in as few composed levels as possible.
+  std::vector<const Message *> order;
+  for (const Message &message : messages) {
+    assert(message.input.size() == message.output.size() &&
+           "Output must match input size");
+    assert(message.positions.size() == message.tables->size() &&
+           "Rotor count mismatch");
+    order.push_back(&message);
+  }
+  std::sort(order.begin(), order.end(),
+            [](const Message *a, const Message *b) {
+              if (a->tables != b->tables) {
+                return a->tables < b->tables;
+              }
+              return std::lexicographical_compare(
+                  a->positions.rbegin(), a->positions.rend(),
+                  b->positions.rbegin(), b->positions.rend());
+            });
+
+  std::optional<ComposedEngine> engine;
+  for (const Message *message : order) {
+    if (message->input.empty()) {
+      continue;
+    }
+    if (!engine || &engine->tables() != message->tables) {
+      engine.emplace(*message->tables, message->positions);
+    }
+
+    std::size_t stale = engine->stale_levels(message->positions);
+    if (message->input.size() < stale * BATCH_BYTES_PER_LEVEL) {
+      Bytenigma::process(*message->tables, message->positions, message->input,
+                         message->output);
+      continue;
+    }
+    engine->reset(message->positions);
+    engine->process(message->input, message->output);
+    std::copy(engine->positions().begin(), engine->positions().end(),
+              message->positions.begin());
+  }
+}
+
+#ifdef TEST
+#include <random>
+
+#include "bytenigma/testing.hpp"
+#include "doctest.h"
+
+TEST_CASE("test batch processing matches processing each message") {
+  std::mt19937 gen(77);
+  std::vector<Bytenigma::RotorTables> tables;
+  for (std::size_t count = 1; count <= 5; ++count) {
+    tables.emplace_back(Bytenigma::Testing::random_rotors(count, gen));
+  }
+
+  // Mixed rotor sets, lengths (including empty messages and messages with
+  // carries into the outer rotors) and start positions, some of them shared
+  const std::size_t count = 200;
+  std::vector<std::size_t> machines(count);
+  std::vector<std::vector<std::uint8_t>> inputs(count), outputs(count),
+      positions(count), expected(count), expected_positions(count);
+  for (std::size_t m = 0; m < count; ++m) {
+    machines[m] = gen() % tables.size();
+    inputs[m].resize(gen() % 600);
+    for (std::uint8_t &byte : inputs[m]) {
+      byte = gen();
+    }
+    positions[m].resize(tables[machines[m]].size());
+    for (std::uint8_t &position : positions[m]) {
+      position = gen() % 3;
+    }
+    outputs[m].resize(inputs[m].size());
+
+    expected[m].resize(inputs[m].size());
+    expected_positions[m] = positions[m];
+    Bytenigma::process(tables[machines[m]], expected_positions[m], inputs[m],
+                       expected[m]);
+  }
+
+  std::vector<Bytenigma::Message> messages;
+  for (std::size_t m = 0; m < count; ++m) {
+    messages.push_back(
+        {&tables[machines[m]], positions[m], inputs[m], outputs[m]});
+  }
+  Bytenigma::process_batch(messages);
+  CHECK(outputs == expected);
+  CHECK(positions == expected_positions);
+}
+#endif
+
+#ifdef BENCH
+#include <random>
+
+#include "benchmark.hpp"
+#include "bytenigma/testing.hpp"
+
+BENCHMARK_CASE("bytenigma batch of 4096 messages of 128 bytes, 4 rotors") {
+  std::mt19937 gen(42);
+  auto rotors = Bytenigma::Testing::random_rotors(4, gen);
+  Bytenigma::RotorTables tables(rotors);
+
+  const std::size_t count = 4096, size = 128;
+  std::vector<std::uint8_t> input(count * size), output(input.size());
+  std::vector<std::uint8_t> positions(count * rotors.size());
+  std::vector<Bytenigma::Message> messages;
+  for (std::size_t m = 0; m < count; ++m) {
+    messages.push_back(
+        {&tables, std::span(positions).subspan(m * rotors.size(), rotors.size()),
+         std::span(input).subspan(m * size, size),
+         std::span(output).subspan(m * size, size)});
+  }
+  auto run = [&](const std::string &name, auto function) {
+    Benchmark::throughput(name, input.size(), [&]() {
+      // Every message starts from the same or from random positions
+      std::fill(positions.begin(), positions.end(), 0);
+      if (name.find("random") != std::string::npos) {
+        std::mt19937 positions_gen(1);
+        for (std::uint8_t &position : positions) {
+          position = positions_gen();
+        }
+      }
+      function();
+    });
+  };
+
+  for (const char *start : {"shared", "random"}) {
+    run(std::string("one at a time, ") + start + " positions", [&]() {
+      for (const Bytenigma::Message &message : messages) {
+        Bytenigma::process(*message.tables, message.positions, message.input,
+                           message.output);
+      }
+    });
+    run(std::string("batch, ") + start + " positions",
+        [&]() { Bytenigma::process_batch(messages); });
+  }
+}
+#endif
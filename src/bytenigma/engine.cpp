@@ -0,0 +1,388 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "bytenigma/engine.hpp"
+#include "parallel.hpp"
+
+Bytenigma::RotorTables::RotorTables(
+    const std::vector<std::vector<std::uint8_t>> &rotors)
+    : m_tables(2 * rotors.size()), m_carry_positions(rotors.size()) {
+  if (rotors.empty()) {
+    throw std::invalid_argument("Bytenigma requires at least one rotor");
+  }
+  for (std::size_t i = 0; i < rotors.size(); ++i) {
+    const std::vector<std::uint8_t> &rotor = rotors[i];
+    if (rotor.size() != Bytenigma::ROTOR_SIZE) {
+      throw std::invalid_argument("Every rotor must have exactly 256 entries");
+    }
+    std::array<bool, Bytenigma::ROTOR_SIZE> seen{};
+    for (std::size_t in = 0; in < Bytenigma::ROTOR_SIZE; ++in) {
+      std::uint8_t out = rotor[in];
+      if (seen[out]) {
+        throw std::invalid_argument(
+            "Every rotor must be a permutation of all byte values");
+      }
+      seen[out] = true;
+      m_tables[i].map[in] = out;
+      m_tables[rotors.size() + i].map[out] = static_cast<std::uint8_t>(in);
+    }
+    m_carry_positions[i] = this->inverse(i)[0];
+  }
+}
+
+bool Bytenigma::RotorTables::matches(
+    const std::vector<std::vector<std::uint8_t>> &rotors) const {
+  if (rotors.size() != this->size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < rotors.size(); ++i) {
+    if (!std::ranges::equal(rotors[i], m_tables[i].map)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::shared_ptr<const Bytenigma::RotorTables> Bytenigma::RotorTables::cached(
+    const std::vector<std::vector<std::uint8_t>> &rotors) {
+  // FNV-1a over all rotors. Collisions are resolved by comparing the tables.
+  std::uint64_t hash = 0xcbf29ce484222325;
+  for (const std::vector<std::uint8_t> &rotor : rotors) {
+    for (std::uint8_t byte : rotor) {
+      hash = (hash ^ byte) * 0x100000001b3;
+    }
+    hash = (hash ^ rotor.size()) * 0x100000001b3;
+  }
+
+  static std::mutex mutex;
+  static std::unordered_multimap<std::uint64_t,
+                                 std::shared_ptr<const RotorTables>>
+      cache;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto [begin, end] = cache.equal_range(hash);
+    for (auto it = begin; it != end; ++it) {
+      if (it->second->matches(rotors)) {
+        return it->second;
+      }
+    }
+  }
+
+  // Build outside of the lock, so that threads with different rotor sets do
+  // not wait for each other. Machines which already hold an evicted context
+  // keep it alive through their shared_ptr.
+  auto tables = std::make_shared<const RotorTables>(rotors);
+  std::lock_guard<std::mutex> lock(mutex);
+  if (cache.size() >= Bytenigma::ROTOR_CACHE_SIZE) {
+    cache.clear();
+  }
+  cache.emplace(hash, tables);
+  return tables;
+}
+
+Bytenigma::ComposedEngine::ComposedEngine(
+    const Bytenigma::RotorTables &tables,
+    std::span<const std::uint8_t> positions,
+    const Bytenigma::SIMD::Kernel &kernel)
+    : m_tables(tables), m_kernel(kernel),
+      m_positions(positions.begin(), positions.end()),
+      m_carry_position(tables.carry_position(0)), m_composed(tables.size() + 1) {
+  assert(positions.size() == tables.size() && "Rotor count mismatch");
+  for (std::size_t y = 0; y < Bytenigma::ROTOR_SIZE; ++y) {
+    m_composed.back().map[y] = ~static_cast<std::uint8_t>(y);
+  }
+  this->rebuild(tables.size() - 1);
+}
+
+void Bytenigma::ComposedEngine::rebuild(std::size_t top) {
+  for (std::size_t k = top; k >= 1; --k) {
+    m_kernel.compose({m_tables.forward(k), m_composed[k + 1].map.data(),
+                      m_tables.inverse(k)},
+                     m_positions[k], m_composed[k].map);
+  }
+}
+
+std::size_t Bytenigma::ComposedEngine::stale_levels(
+    std::span<const std::uint8_t> positions) const {
+  assert(positions.size() == m_positions.size() && "Rotor count mismatch");
+  for (std::size_t k = m_positions.size(); k-- > 1;) {
+    if (positions[k] != m_positions[k]) {
+      return k;
+    }
+  }
+  return 0;
+}
+
+void Bytenigma::ComposedEngine::reset(std::span<const std::uint8_t> positions) {
+  std::size_t top = this->stale_levels(positions);
+  std::copy(positions.begin(), positions.end(), m_positions.begin());
+  if (top > 0) {
+    this->rebuild(top);
+  }
+}
+
+void Bytenigma::ComposedEngine::process(std::span<const std::uint8_t> input,
+                                        std::span<std::uint8_t> output) {
+  assert(input.size() == output.size() && "Output must match input size");
+  std::size_t done = 0;
+  while (done < input.size()) {
+    // Rotor 0 carries after the byte processed at m_carry_position, so all
+    // bytes up to and including that one see the same outer rotors.
+    std::uint8_t position = m_positions[0];
+    std::size_t run = static_cast<std::uint8_t>(m_carry_position - position);
+    run = std::min(run + 1, input.size() - done);
+
+    m_kernel.run({m_tables.forward(0), m_composed[1].map.data(),
+                  m_tables.inverse(0)},
+                 input.subspan(done, run), output.subspan(done, run),
+                 position);
+    done += run;
+    position += run;
+    m_positions[0] = position;
+
+    if (static_cast<std::uint8_t>(position - 1) != m_carry_position) {
+      continue;
+    }
+    // Carry into rotor 1 and onwards, then rebuild every level that turned.
+    std::size_t top = 0;
+    while (++top < m_tables.size()) {
+      if (m_tables.forward(top)[m_positions[top]++] != 0)
+        break;
+    }
+    if (m_tables.size() > 1) {
+      this->rebuild(std::min(top, m_tables.size() - 1));
+    }
+  }
+}
+
+void Bytenigma::process(const Bytenigma::RotorTables &tables,
+                        std::span<std::uint8_t> positions,
+                        std::span<const std::uint8_t> input,
+                        std::span<std::uint8_t> output) {
+  if (tables.size() >= Bytenigma::COMPOSED_MIN_ROTORS &&
+      input.size() >= Bytenigma::ROTOR_SIZE) {
+    Bytenigma::ComposedEngine engine(tables, positions);
+    engine.process(input, output);
+    std::copy(engine.positions().begin(), engine.positions().end(),
+              positions.begin());
+    return;
+  }
+
+  // One instantiation per rotor count up to MAX_UNROLLED_ROTORS
+  switch (tables.size()) {
+  case 1:
+    return Bytenigma::Engine<1>::process(tables, positions, input, output);
+  case 2:
+    return Bytenigma::Engine<2>::process(tables, positions, input, output);
+  case 3:
+    return Bytenigma::Engine<3>::process(tables, positions, input, output);
+  case 4:
+    return Bytenigma::Engine<4>::process(tables, positions, input, output);
+  case 5:
+    return Bytenigma::Engine<5>::process(tables, positions, input, output);
+  case 6:
+    return Bytenigma::Engine<6>::process(tables, positions, input, output);
+  case 7:
+    return Bytenigma::Engine<7>::process(tables, positions, input, output);
+  case 8:
+    return Bytenigma::Engine<8>::process(tables, positions, input, output);
+  default:
+    return Bytenigma::Engine<Bytenigma::DYNAMIC_ROTOR_COUNT>::process(
+        tables, positions, input, output);
+  }
+}
+
+void Bytenigma::advance(const Bytenigma::RotorTables &tables,
+                        std::span<std::uint8_t> positions,
+                        std::uint64_t steps) {
+  assert(positions.size() == tables.size() && "Rotor count mismatch");
+  for (std::size_t i = 0; i < tables.size() && steps > 0; ++i) {
+    // Rotor i carries whenever it turns away from the position of its 0, which
+    // it first reaches after `distance` turns and then every 256 turns.
+    std::uint8_t position = positions[i];
+    std::uint8_t carry_position = tables.carry_position(i);
+    std::uint64_t distance = static_cast<std::uint8_t>(carry_position - position);
+    positions[i] = static_cast<std::uint8_t>(position + steps);
+    steps = steps > distance ? (steps - distance - 1) / ROTOR_SIZE + 1 : 0;
+  }
+}
+
+void Bytenigma::process_parallel(const Bytenigma::RotorTables &tables,
+                                 std::span<std::uint8_t> positions,
+                                 std::span<const std::uint8_t> input,
+                                 std::span<std::uint8_t> output,
+                                 std::size_t threads) {
+  assert(input.size() == output.size() && "Output must match input size");
+  if (threads <= 1 || input.size() < Bytenigma::PARALLEL_MIN_BYTES) {
+    return Bytenigma::process(tables, positions, input, output);
+  }
+
+  // A few chunks per thread, so that a slow thread does not hold up the rest.
+  // Chunks are multiples of the carry period of rotor 0.
+  std::size_t chunks = threads * 4;
+  std::size_t chunk_size = (input.size() + chunks - 1) / chunks;
+  chunk_size = (chunk_size + ROTOR_SIZE - 1) / ROTOR_SIZE * ROTOR_SIZE;
+  chunks = (input.size() + chunk_size - 1) / chunk_size;
+
+  const std::vector<std::uint8_t> start(positions.begin(), positions.end());
+  Parallel::for_each_index(
+      chunks,
+      [&](std::size_t chunk) {
+        std::size_t offset = chunk * chunk_size;
+        std::size_t size = std::min(chunk_size, input.size() - offset);
+        std::vector<std::uint8_t> chunk_positions = start;
+        Bytenigma::advance(tables, chunk_positions, offset);
+        Bytenigma::process(tables, chunk_positions,
+                           input.subspan(offset, size),
+                           output.subspan(offset, size));
+      },
+      threads);
+  Bytenigma::advance(tables, positions, input.size());
+}
+
+#ifdef TEST
+#include <numeric>
+#include <random>
+
+#include "bytenigma/testing.hpp"
+#include "doctest.h"
+
+TEST_CASE("test rotor tables reject invalid rotors") {
+  std::vector<std::uint8_t> identity(256);
+  for (std::size_t i = 0; i < identity.size(); ++i) {
+    identity[i] = i;
+  }
+  CHECK_NOTHROW(Bytenigma::RotorTables({identity}));
+  CHECK_THROWS_AS(Bytenigma::RotorTables({}), std::invalid_argument);
+
+  std::vector<std::uint8_t> too_short(identity.begin(), identity.end() - 1);
+  CHECK_THROWS_AS(Bytenigma::RotorTables({identity, too_short}),
+                  std::invalid_argument);
+
+  std::vector<std::uint8_t> duplicate = identity;
+  duplicate[1] = 0;
+  CHECK_THROWS_AS(Bytenigma::RotorTables({duplicate}), std::invalid_argument);
+}
+
+TEST_CASE("test rotor tables store forward and inverse rotors") {
+  std::vector<std::uint8_t> rotor(256);
+  for (std::size_t i = 0; i < rotor.size(); ++i) {
+    rotor[i] = (i * 7 + 3) % 256; // 7 is coprime to 256
+  }
+  Bytenigma::RotorTables tables({rotor, rotor});
+  CHECK(tables.size() == 2);
+  for (std::size_t x = 0; x < 256; ++x) {
+    CHECK(tables.forward(1)[x] == rotor[x]);
+    CHECK(tables.inverse(1)[tables.forward(1)[x]] == x);
+  }
+}
+
+TEST_CASE("test composed engine matches unrolled engine") {
+  std::mt19937 gen(1234);
+  for (std::size_t count = 1; count <= 10; ++count) {
+    auto rotors = Bytenigma::Testing::random_rotors(count, gen);
+    std::vector<std::uint8_t> positions(count);
+    for (std::uint8_t &position : positions) {
+      position = gen();
+    }
+    Bytenigma::RotorTables tables(rotors);
+
+    std::vector<std::uint8_t> input(70000);
+    for (std::uint8_t &byte : input) {
+      byte = gen();
+    }
+    std::vector<std::uint8_t> expected(input.size());
+    std::vector<std::uint8_t> expected_positions = positions;
+    Bytenigma::Engine<Bytenigma::DYNAMIC_ROTOR_COUNT>::process(
+        tables, expected_positions, input, expected);
+
+    // Feed the composed engine in uneven pieces to cover runs which end in
+    // the middle of a carry period.
+    Bytenigma::ComposedEngine engine(tables, positions);
+    std::vector<std::uint8_t> actual(input.size());
+    for (std::size_t offset = 0, size = 1; offset < input.size();
+         offset += size, size = size * 3 + 1) {
+      size = std::min(size, input.size() - offset);
+      engine.process(std::span(input).subspan(offset, size),
+                     std::span(actual).subspan(offset, size));
+    }
+    CHECK(actual == expected);
+    CHECK(std::ranges::equal(engine.positions(), expected_positions));
+  }
+}
+
+TEST_CASE("test advance matches turning the rotors step by step") {
+  std::mt19937 gen(99);
+  // Identity rotors carry on every turn from position 0, so deep carry chains
+  // are reached quickly; shuffled rotors cover arbitrary carry positions.
+  std::vector<std::uint8_t> identity(256);
+  std::iota(identity.begin(), identity.end(), 0);
+  for (bool shuffled : {false, true}) {
+    auto rotors = shuffled ? Bytenigma::Testing::random_rotors(4, gen)
+                           : std::vector<std::vector<std::uint8_t>>(4, identity);
+    std::vector<std::uint8_t> positions(rotors.size());
+    for (std::uint8_t &position : positions) {
+      position = gen();
+    }
+    Bytenigma::RotorTables tables(rotors);
+
+    std::vector<std::uint8_t> expected = positions;
+    std::uint64_t done = 0;
+    for (std::uint64_t steps : {0, 1, 255, 256, 257, 65535, 65536, 200000}) {
+      std::vector<std::uint8_t> zeros(steps - done), ignored(steps - done);
+      Bytenigma::Engine<Bytenigma::DYNAMIC_ROTOR_COUNT>::process(
+          tables, expected, zeros, ignored);
+      done = steps;
+
+      std::vector<std::uint8_t> actual = positions;
+      Bytenigma::advance(tables, actual, steps);
+      CHECK(actual == expected);
+    }
+  }
+}
+
+TEST_CASE("test parallel processing matches serial processing") {
+  std::mt19937 gen(4321);
+  auto rotors = Bytenigma::Testing::random_rotors(3, gen);
+  std::vector<std::uint8_t> positions(rotors.size());
+  for (std::uint8_t &position : positions) {
+    position = gen();
+  }
+  Bytenigma::RotorTables tables(rotors);
+
+  // Not a multiple of the chunk size, so that the last chunk is shorter
+  std::vector<std::uint8_t> input(Bytenigma::PARALLEL_MIN_BYTES + 12345);
+  for (std::uint8_t &byte : input) {
+    byte = gen();
+  }
+  std::vector<std::uint8_t> expected(input.size());
+  std::vector<std::uint8_t> expected_positions = positions;
+  Bytenigma::process(tables, expected_positions, input, expected);
+
+  std::vector<std::uint8_t> actual(input.size());
+  Bytenigma::process_parallel(tables, positions, input, actual, 4);
+  CHECK(actual == expected);
+  CHECK(positions == expected_positions);
+}
+
+TEST_CASE("test rotor tables are shared between identical rotor sets") {
+  std::vector<std::uint8_t> rotor(256);
+  std::iota(rotor.begin(), rotor.end(), 0);
+  auto tables = Bytenigma::RotorTables::cached({rotor, rotor});
+  CHECK(Bytenigma::RotorTables::cached({rotor, rotor}) == tables);
+  CHECK(tables->carry_position(1) == 0);
+
+  std::swap(rotor[0], rotor[1]);
+  auto other = Bytenigma::RotorTables::cached({rotor, rotor});
+  CHECK(other != tables);
+  CHECK(other->carry_position(1) == 1);
+}
+#endif
@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "bytenigma.hpp"
+#include "bytenigma/search.hpp"
+
+std::vector<std::vector<std::uint8_t>>
+Bytenigma::find_positions(const std::shared_ptr<const RotorTables> &context,
+                          std::span<const std::uint8_t> plaintext,
+                          std::span<const std::uint8_t> ciphertext,
+                          std::size_t threads) {
+  const RotorTables &tables = *context;
+  const std::size_t count = tables.size();
+  if (count > MAX_SEARCH_ROTORS) {
+    throw std::invalid_argument("Searching more than 4 rotors is not supported");
+  }
+  if (plaintext.empty() || plaintext.size() != ciphertext.size()) {
+    throw std::invalid_argument(
+        "Plaintext and ciphertext must be non-empty and of the same length");
+  }
+
+  const SIMD::Kernel &kernel = SIMD::best_kernel();
+  const std::vector<std::uint8_t> trial(ROTOR_SIZE, plaintext[0]);
+
+  // One task per position of the last rotor. The rotors in between are
+  // enumerated within each task.
+  const std::size_t tasks = count == 1 ? 1 : ROTOR_SIZE;
+  std::size_t states_per_task = 1;
+  for (std::size_t i = 2; i < count; ++i) {
+    states_per_task *= ROTOR_SIZE;
+  }
+
+  auto found = std::vector<std::vector<std::vector<std::uint8_t>>>(tasks);
+  Parallel::for_each_index(
+      tasks,
+      [&](std::size_t task) {
+        auto composed = std::vector<Rotor>(count + 1);
+        for (std::size_t y = 0; y < ROTOR_SIZE; ++y) {
+          composed.back().map[y] = ~static_cast<std::uint8_t>(y);
+        }
+        auto positions = std::vector<std::uint8_t>(count);
+        positions.back() = task;
+        std::array<std::uint8_t, ROTOR_SIZE> results;
+
+        for (std::size_t state = 0; state < states_per_task; ++state) {
+          // Advance rotors 1..n-2 like an odometer and only rebuild the
+          // levels which changed.
+          std::size_t top = count - 1;
+          if (state > 0) {
+            top = 1;
+            while (++positions[top] == 0) {
+              ++top;
+            }
+          }
+          for (std::size_t k = top; k >= 1; --k) {
+            kernel.compose({tables.forward(k), composed[k + 1].map.data(),
+                            tables.inverse(k)},
+                           positions[k], composed[k].map);
+          }
+
+          kernel.run({tables.forward(0), composed[1].map.data(),
+                      tables.inverse(0)},
+                     trial, results, 0);
+          for (std::size_t p0 = 0; p0 < ROTOR_SIZE; ++p0) {
+            if (results[p0] != ciphertext[0]) {
+              continue;
+            }
+            positions[0] = p0;
+            Bytenigma machine = Bytenigma(context, positions);
+            std::size_t i = 0;
+            while (i < plaintext.size() &&
+                   machine.process_byte(plaintext[i]) == ciphertext[i]) {
+              ++i;
+            }
+            if (i == plaintext.size()) {
+              found[task].push_back(positions);
+            }
+          }
+        }
+      },
+      threads);
+
+  auto matches = std::vector<std::vector<std::uint8_t>>();
+  for (std::vector<std::vector<std::uint8_t>> &task_matches : found) {
+    matches.insert(matches.end(), task_matches.begin(), task_matches.end());
+  }
+  std::sort(matches.begin(), matches.end());
+  return matches;
+}
+
+#ifdef TEST
+#include <numeric>
+#include <random>
+
+#include "bytenigma/testing.hpp"
+#include "doctest.h"
+
+TEST_CASE("test bytenigma search finds all start positions") {
+  std::mt19937 gen(2024);
+  for (std::size_t count = 1; count <= 3; ++count) {
+    auto rotors = Bytenigma::Testing::random_rotors(count, gen);
+    std::vector<std::uint8_t> positions(count);
+    for (std::uint8_t &position : positions) {
+      position = gen();
+    }
+    auto context = Bytenigma::RotorTables::cached(rotors);
+
+    // Two bytes leave a few false positives for up to two rotors, which must
+    // all be reported.
+    std::vector<std::uint8_t> plaintext = {0x13, 0x37};
+    std::vector<std::uint8_t> ciphertext =
+        Bytenigma::Bytenigma(context, positions).process_bytes(plaintext);
+    auto matches = Bytenigma::find_positions(context, plaintext, ciphertext, 3);
+    CHECK(std::ranges::binary_search(matches, positions));
+
+    if (count <= 2) {
+      // Compare with a brute force search
+      std::vector<std::vector<std::uint8_t>> expected;
+      for (std::size_t state = 0; state < (count == 1 ? 256 : 65536);
+           ++state) {
+        std::vector<std::uint8_t> candidate = {
+            static_cast<std::uint8_t>(state)};
+        if (count == 2) {
+          candidate.push_back(state >> 8);
+        }
+        if (Bytenigma::Bytenigma(context, candidate).process_bytes(
+                plaintext) == ciphertext) {
+          expected.push_back(candidate);
+        }
+      }
+      std::sort(expected.begin(), expected.end());
+      CHECK(matches == expected);
+    }
+  }
+}
+
+TEST_CASE("test bytenigma search rejects invalid input") {
+  std::vector<std::uint8_t> rotor(256);
+  std::iota(rotor.begin(), rotor.end(), 0);
+  auto context = Bytenigma::RotorTables::cached({rotor, rotor, rotor, rotor,
+                                                 rotor});
+  std::vector<std::uint8_t> text = {1, 2, 3};
+  CHECK_THROWS_AS(Bytenigma::find_positions(context, text, text),
+                  std::invalid_argument);
+  context = Bytenigma::RotorTables::cached({rotor});
+  CHECK_THROWS_AS(Bytenigma::find_positions(context, {}, {}),
+                  std::invalid_argument);
+  CHECK_THROWS_AS(Bytenigma::find_positions(context, text,
+                                            std::span(text).first(2)),
+                  std::invalid_argument);
+}
+#endif
@@ -0,0 +1,353 @@
+#include <cstdint>
+#include <immintrin.h>
+#include <span>
+#include <vector>
+
+#include "bytenigma/simd.hpp"
+#include "cpu.hpp"
+
+void Bytenigma::SIMD::run_scalar(const Bytenigma::SIMD::RunTables &tables,
+                                 std::span<const std::uint8_t> input,
+                                 std::span<std::uint8_t> output,
+                                 std::uint8_t position) {
+  for (std::size_t j = 0; j < input.size(); ++j, ++position) {
+    std::uint8_t x =
+        tables.forward[static_cast<std::uint8_t>(input[j] + position)];
+    output[j] = tables.inverse[tables.composed[x]] - position;
+  }
+}
+
+void Bytenigma::SIMD::compose_scalar(const Bytenigma::SIMD::RunTables &tables,
+                                     std::uint8_t position,
+                                     std::span<std::uint8_t, 256> output) {
+  for (std::size_t y = 0; y < output.size(); ++y) {
+    std::uint8_t x = tables.forward[static_cast<std::uint8_t>(y + position)];
+    output[y] = tables.inverse[tables.composed[x]] - position;
+  }
+}
+
+/// @brief look up 16 bytes in a 256-entry table using one `pshufb` per
+/// 16-byte sub-table, keeping the result of the sub-table selected by the
+/// high nibble of each index.
+CPU_TARGET("ssse3") CPU_INLINE __m128i
+lookup_ssse3(const std::uint8_t *table, __m128i index) {
+  const __m128i nibble = _mm_set1_epi8(0x0f);
+  __m128i low = _mm_and_si128(index, nibble);
+  __m128i high = _mm_and_si128(_mm_srli_epi16(index, 4), nibble);
+  __m128i result = _mm_setzero_si128();
+#pragma GCC unroll 16
+  for (int k = 0; k < 16; ++k) {
+    __m128i sub = _mm_loadu_si128(reinterpret_cast<const __m128i *>(table) + k);
+    __m128i match = _mm_cmpeq_epi8(high, _mm_set1_epi8(k));
+    result =
+        _mm_or_si128(result, _mm_and_si128(match, _mm_shuffle_epi8(sub, low)));
+  }
+  return result;
+}
+
+/// @brief `inverse[composed[forward[x + positions]]] - positions` for 16 bytes
+CPU_TARGET("ssse3") CPU_INLINE __m128i
+chain_ssse3(const Bytenigma::SIMD::RunTables &tables, __m128i x,
+            __m128i positions) {
+  x = lookup_ssse3(tables.forward, _mm_add_epi8(x, positions));
+  x = lookup_ssse3(tables.composed, x);
+  return _mm_sub_epi8(lookup_ssse3(tables.inverse, x), positions);
+}
+
+CPU_TARGET("ssse3") void
+Bytenigma::SIMD::run_ssse3(const Bytenigma::SIMD::RunTables &tables,
+                           std::span<const std::uint8_t> input,
+                           std::span<std::uint8_t> output,
+                           std::uint8_t position) {
+  const __m128i step = _mm_set1_epi8(16);
+  __m128i positions =
+      _mm_add_epi8(_mm_set1_epi8(position),
+                   _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13,
+                                 14, 15));
+  std::size_t j = 0;
+  for (; j + 16 <= input.size(); j += 16) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&input[j]));
+    x = chain_ssse3(tables, x, positions);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&output[j]), x);
+    positions = _mm_add_epi8(positions, step);
+  }
+  Bytenigma::SIMD::run_scalar(tables, input.subspan(j), output.subspan(j),
+                              position + j);
+}
+
+CPU_TARGET("ssse3") void
+Bytenigma::SIMD::compose_ssse3(const Bytenigma::SIMD::RunTables &tables,
+                               std::uint8_t position,
+                               std::span<std::uint8_t, 256> output) {
+  const __m128i step = _mm_set1_epi8(16);
+  const __m128i positions = _mm_set1_epi8(position);
+  __m128i y = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+                            15);
+  for (std::size_t j = 0; j < output.size(); j += 16) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&output[j]),
+                     chain_ssse3(tables, y, positions));
+    y = _mm_add_epi8(y, step);
+  }
+}
+
+/// @brief the AVX2 version of lookup_ssse3. `vpshufb` works within 128-bit
+/// lanes, so every sub-table is broadcast to both lanes. Instead of comparing
+/// the high nibble against every sub-table index, the 16 candidates are merged
+/// in a binary tree of blends on index bits 4 to 7.
+CPU_TARGET("avx2") CPU_INLINE __m256i
+lookup_avx2(const std::uint8_t *table, __m256i index) {
+  __m256i low = _mm256_and_si256(index, _mm256_set1_epi8(0x0f));
+  __m256i candidates[16];
+#pragma GCC unroll 16
+  for (int k = 0; k < 16; ++k) {
+    __m256i sub = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(table) + k));
+    candidates[k] = _mm256_shuffle_epi8(sub, low);
+  }
+  // `vpblendvb` selects on the top bit of each byte, so shift bit 4, 5, 6
+  // and 7 of the index into that position in turn.
+#pragma GCC unroll 4
+  for (int bit = 4, count = 16; bit < 8; ++bit, count /= 2) {
+    __m256i select = _mm256_slli_epi16(index, 7 - bit);
+#pragma GCC unroll 8
+    for (int k = 0; k < count / 2; ++k) {
+      candidates[k] = _mm256_blendv_epi8(candidates[2 * k],
+                                         candidates[2 * k + 1], select);
+    }
+  }
+  return candidates[0];
+}
+
+/// @brief `inverse[composed[forward[x + positions]]] - positions` for 32 bytes
+CPU_TARGET("avx2") CPU_INLINE __m256i
+chain_avx2(const Bytenigma::SIMD::RunTables &tables, __m256i x,
+           __m256i positions) {
+  x = lookup_avx2(tables.forward, _mm256_add_epi8(x, positions));
+  x = lookup_avx2(tables.composed, x);
+  return _mm256_sub_epi8(lookup_avx2(tables.inverse, x), positions);
+}
+
+/// @brief the bytes 0 to 31
+CPU_TARGET("avx2") CPU_INLINE __m256i iota_avx2() {
+  return _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+                          16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28,
+                          29, 30, 31);
+}
+
+CPU_TARGET("avx2") void
+Bytenigma::SIMD::run_avx2(const Bytenigma::SIMD::RunTables &tables,
+                          std::span<const std::uint8_t> input,
+                          std::span<std::uint8_t> output,
+                          std::uint8_t position) {
+  const __m256i step = _mm256_set1_epi8(32);
+  __m256i positions = _mm256_add_epi8(_mm256_set1_epi8(position), iota_avx2());
+  std::size_t j = 0;
+  for (; j + 32 <= input.size(); j += 32) {
+    __m256i x =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&input[j]));
+    x = chain_avx2(tables, x, positions);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(&output[j]), x);
+    positions = _mm256_add_epi8(positions, step);
+  }
+  Bytenigma::SIMD::run_scalar(tables, input.subspan(j), output.subspan(j),
+                              position + j);
+}
+
+CPU_TARGET("avx2") void
+Bytenigma::SIMD::compose_avx2(const Bytenigma::SIMD::RunTables &tables,
+                              std::uint8_t position,
+                              std::span<std::uint8_t, 256> output) {
+  const __m256i step = _mm256_set1_epi8(32);
+  const __m256i positions = _mm256_set1_epi8(position);
+  __m256i y = iota_avx2();
+  for (std::size_t j = 0; j < output.size(); j += 32) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(&output[j]),
+                        chain_avx2(tables, y, positions));
+    y = _mm256_add_epi8(y, step);
+  }
+}
+
+/// @brief a 256-entry table held in four 64-byte registers
+struct Table512 {
+  __m512i quarter[4];
+};
+
+/// @brief the three tables of a run, held in registers
+struct RunTables512 {
+  Table512 forward, composed, inverse;
+};
+
+CPU_TARGET("avx512f,avx512bw,avx512vbmi") CPU_INLINE Table512
+load_avx512(const std::uint8_t *table) {
+  Table512 out;
+  for (int i = 0; i < 4; ++i) {
+    out.quarter[i] = _mm512_loadu_si512(table + 64 * i);
+  }
+  return out;
+}
+
+CPU_TARGET("avx512f,avx512bw,avx512vbmi") CPU_INLINE RunTables512
+load_avx512(const Bytenigma::SIMD::RunTables &tables) {
+  return {load_avx512(tables.forward), load_avx512(tables.composed),
+          load_avx512(tables.inverse)};
+}
+
+/// @brief look up 64 bytes in a 256-entry table: `vpermi2b` selects from 128
+/// entries using the low 7 bits, bit 7 of each index then picks the half.
+CPU_TARGET("avx512f,avx512bw,avx512vbmi") CPU_INLINE __m512i
+lookup_avx512vbmi(const Table512 &table, __m512i index) {
+  __m512i low =
+      _mm512_permutex2var_epi8(table.quarter[0], index, table.quarter[1]);
+  __m512i high =
+      _mm512_permutex2var_epi8(table.quarter[2], index, table.quarter[3]);
+  return _mm512_mask_blend_epi8(_mm512_movepi8_mask(index), low, high);
+}
+
+/// @brief `inverse[composed[forward[x + positions]]] - positions` for 64 bytes
+CPU_TARGET("avx512f,avx512bw,avx512vbmi") CPU_INLINE __m512i
+chain_avx512vbmi(const RunTables512 &tables, __m512i x, __m512i positions) {
+  x = lookup_avx512vbmi(tables.forward, _mm512_add_epi8(x, positions));
+  x = lookup_avx512vbmi(tables.composed, x);
+  return _mm512_sub_epi8(lookup_avx512vbmi(tables.inverse, x), positions);
+}
+
+/// @brief the bytes \p start to \p start + 63, wrapping around
+CPU_TARGET("avx512f,avx512bw,avx512vbmi") CPU_INLINE __m512i
+iota_avx512(std::uint8_t start) {
+  alignas(64) std::uint8_t lanes[64];
+  for (std::uint8_t i = 0; i < 64; ++i) {
+    lanes[i] = start + i;
+  }
+  return _mm512_load_si512(lanes);
+}
+
+CPU_TARGET("avx512f,avx512bw,avx512vbmi") void
+Bytenigma::SIMD::run_avx512vbmi(const Bytenigma::SIMD::RunTables &tables,
+                                std::span<const std::uint8_t> input,
+                                std::span<std::uint8_t> output,
+                                std::uint8_t position) {
+  const __m512i step = _mm512_set1_epi8(64);
+  const RunTables512 registers = load_avx512(tables);
+  __m512i positions = iota_avx512(position);
+  std::size_t j = 0;
+  for (; j + 64 <= input.size(); j += 64) {
+    __m512i x = _mm512_loadu_si512(&input[j]);
+    _mm512_storeu_si512(&output[j], chain_avx512vbmi(registers, x, positions));
+    positions = _mm512_add_epi8(positions, step);
+  }
+  Bytenigma::SIMD::run_scalar(tables, input.subspan(j), output.subspan(j),
+                              position + j);
+}
+
+CPU_TARGET("avx512f,avx512bw,avx512vbmi") void
+Bytenigma::SIMD::compose_avx512vbmi(const Bytenigma::SIMD::RunTables &tables,
+                                    std::uint8_t position,
+                                    std::span<std::uint8_t, 256> output) {
+  const __m512i step = _mm512_set1_epi8(64);
+  const RunTables512 registers = load_avx512(tables);
+  const __m512i positions = _mm512_set1_epi8(position);
+  __m512i y = iota_avx512(0);
+  for (std::size_t j = 0; j < output.size(); j += 64) {
+    _mm512_storeu_si512(&output[j], chain_avx512vbmi(registers, y, positions));
+    y = _mm512_add_epi8(y, step);
+  }
+}
+
+std::vector<Bytenigma::SIMD::Kernel> Bytenigma::SIMD::supported_kernels() {
+  const CPU::Features &cpu = CPU::features();
+  std::vector<Bytenigma::SIMD::Kernel> kernels;
+  if (cpu.avx512f && cpu.avx512bw && cpu.avx512vbmi) {
+    kernels.push_back({"avx512vbmi", Bytenigma::SIMD::run_avx512vbmi,
+                       Bytenigma::SIMD::compose_avx512vbmi});
+  }
+  if (cpu.avx2) {
+    kernels.push_back(
+        {"avx2", Bytenigma::SIMD::run_avx2, Bytenigma::SIMD::compose_avx2});
+  }
+  kernels.push_back({"scalar", Bytenigma::SIMD::run_scalar,
+                     Bytenigma::SIMD::compose_scalar});
+  // 16 shuffles per lookup are slower than the scalar loads, so the SSSE3
+  // kernel is never picked automatically.
+  if (cpu.ssse3) {
+    kernels.push_back(
+        {"ssse3", Bytenigma::SIMD::run_ssse3, Bytenigma::SIMD::compose_ssse3});
+  }
+  return kernels;
+}
+
+const Bytenigma::SIMD::Kernel &Bytenigma::SIMD::best_kernel() {
+  static const Bytenigma::SIMD::Kernel kernel =
+      Bytenigma::SIMD::supported_kernels().front();
+  return kernel;
+}
+
+#ifdef TEST
+#include <array>
+#include <random>
+
+#include "bytenigma/testing.hpp"
+#include "doctest.h"
+
+TEST_CASE("test bytenigma SIMD kernels match the scalar kernel") {
+  std::mt19937 gen(42);
+  auto tables = Bytenigma::Testing::random_rotors(3, gen);
+  Bytenigma::SIMD::RunTables run = {tables[0].data(), tables[1].data(),
+                                    tables[2].data()};
+
+  std::vector<std::uint8_t> input(256);
+  for (std::uint8_t &byte : input) {
+    byte = gen();
+  }
+  for (const Bytenigma::SIMD::Kernel &kernel :
+       Bytenigma::SIMD::supported_kernels()) {
+    CAPTURE(kernel.name);
+    // Every run length a ComposedEngine can request, from varying offsets
+    // so that unaligned loads and the scalar tail are covered.
+    for (std::size_t length = 0; length <= 256; length += 13) {
+      std::size_t offset = (256 - length) / 2;
+      std::uint8_t position = gen();
+      auto in = std::span(input).subspan(offset, length);
+      std::vector<std::uint8_t> expected(length), actual(length);
+      Bytenigma::SIMD::run_scalar(run, in, expected, position);
+      kernel.run(run, in, actual, position);
+      CHECK(actual == expected);
+    }
+
+    std::uint8_t position = gen();
+    std::array<std::uint8_t, 256> expected, actual;
+    Bytenigma::SIMD::compose_scalar(run, position, expected);
+    kernel.compose(run, position, actual);
+    CHECK(actual == expected);
+  }
+}
+#endif
+
+#ifdef BENCH
+#include <random>
+
+#include "benchmark.hpp"
+#include "bytenigma/engine.hpp"
+#include "bytenigma/testing.hpp"
+
+BENCHMARK_CASE("bytenigma kernels, 8 rotors") {
+  std::mt19937 gen(42);
+  auto rotors = Bytenigma::Testing::random_rotors(8, gen);
+  Bytenigma::RotorTables tables(rotors);
+  std::vector<std::uint8_t> positions(rotors.size());
+  std::vector<std::uint8_t> input(1 << 24), output(input.size());
+  for (std::uint8_t &byte : input) {
+    byte = gen();
+  }
+
+  Benchmark::throughput("unrolled engine", input.size(), [&]() {
+    Bytenigma::Engine<8>::process(tables, positions, input, output);
+  });
+  for (const Bytenigma::SIMD::Kernel &kernel :
+       Bytenigma::SIMD::supported_kernels()) {
+    Bytenigma::ComposedEngine engine(tables, positions, kernel);
+    Benchmark::throughput(std::string("composed engine, ") + kernel.name,
+                          input.size(),
+                          [&]() { engine.process(input, output); });
+  }
+}
+#endif
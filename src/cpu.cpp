@@ -0,0 +1,51 @@
+#include <cpuid.h>
+#include <cstdint>
+
+#include "cpu.hpp"
+
+/// @brief read the extended control register \p index
+/// @param index the XCR to read, 0 for XCR0
+/// @return the value of the register
+static std::uint64_t xgetbv(std::uint32_t index) {
+  std::uint32_t eax, edx;
+  __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(index));
+  return (static_cast<std::uint64_t>(edx) << 32) | eax;
+}
+
+/// @brief detect the features of the host CPU
+/// @return the supported features
+static CPU::Features detect() {
+  CPU::Features features{};
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+    return features;
+  }
+  features.ssse3 = ecx & bit_SSSE3;
+  features.sse41 = ecx & bit_SSE4_1;
+  features.pclmul = ecx & bit_PCLMUL;
+  features.aesni = ecx & bit_AES;
+
+  // The wider registers are only usable if the OS saves them on context
+  // switches, which is reported in XCR0.
+  bool os_ymm = false, os_zmm = false;
+  if ((ecx & bit_OSXSAVE) && (ecx & bit_AVX)) {
+    std::uint64_t xcr0 = xgetbv(0);
+    os_ymm = (xcr0 & 0x6) == 0x6;
+    os_zmm = os_ymm && (xcr0 & 0xe0) == 0xe0;
+  }
+
+  if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+    return features;
+  }
+  features.avx2 = os_ymm && (ebx & bit_AVX2);
+  features.avx512f = os_zmm && (ebx & bit_AVX512F);
+  features.avx512bw = features.avx512f && (ebx & bit_AVX512BW);
+  features.avx512vbmi = features.avx512f && (ecx & bit_AVX512VBMI);
+  features.vpclmulqdq = os_ymm && (ecx & bit_VPCLMULQDQ);
+  return features;
+}
+
+const CPU::Features &CPU::features() {
+  static const CPU::Features features = detect();
+  return features;
+}
@@ -0,0 +1,148 @@
+#include <cstdint>
+#include <vector>
+
+#include "galois/polynomial.hpp"
+#include "gcm/polynomial.hpp"
+
+// Galois::Polynomial is header-only; this file holds its tests and benchmarks.
+
+#ifdef TEST
+#include "doctest.h"
+
+namespace {
+using GF64 = Galois::Polynomial<64, 0x1b>;
+using GF64ShiftXor = Galois::Polynomial<64, 0x1b, Galois::BitOrder::Natural,
+                                        Galois::Reduction::ShiftXor>;
+using GF128 = Galois::Polynomial<128, 0x87>;
+using GF128ShiftXor =
+    Galois::Polynomial<128, 0x87, Galois::BitOrder::Natural,
+                       Galois::Reduction::ShiftXor>;
+using GF256 = Galois::Polynomial<256, 0x425>;
+using GF256ShiftXor =
+    Galois::Polynomial<256, 0x425, Galois::BitOrder::Natural,
+                       Galois::Reduction::ShiftXor>;
+
+/// @brief a deterministic element, usable in constant expressions
+template <typename Field> constexpr Field sample(std::uint64_t seed) {
+  typename Field::Limbs limbs;
+  for (std::uint64_t &limb : limbs) {
+    seed = seed * 6364136223846793005 + 1442695040888963407;
+    limb = seed;
+  }
+  return Field(limbs);
+}
+
+/// @brief map from natural to GCM (reflected) bit order
+GCM::Polynomial reflect(const GF128 &x) {
+  return GCM::Polynomial(Galois::reverse_bits(x.limbs()[0]),
+                         Galois::reverse_bits(x.limbs()[1]));
+}
+} // namespace
+
+TEST_CASE_TEMPLATE("Galois field axioms", Field, GF64, GF64ShiftXor, GF128,
+                   GF128ShiftXor, GF256, GF256ShiftXor, GCM::Field) {
+  for (int i = 0; i < 8; ++i) {
+    Field a = Field::random(), b = Field::random(), c = Field::random();
+    CHECK(a * (b + c) == a * b + a * c);
+    CHECK((a * b) * c == a * (b * c));
+    CHECK(a * b == b * a);
+    CHECK(a * Field::one() == a);
+    CHECK(a.square() == a * a);
+    CHECK(a.pow(5) == a * a * a * a * a);
+    CHECK(a * a.modular_inverse() == Field::one());
+
+    // x^(2^N) = x for every element of GF(2^N)
+    Field frobenius = a;
+    for (std::size_t k = 0; k < Field::BITS; ++k) {
+      frobenius = frobenius.square();
+    }
+    CHECK(frobenius == a);
+  }
+  CHECK(Field::zero().modular_inverse() == Field::zero());
+}
+
+TEST_CASE_TEMPLATE("Galois constant evaluation matches intrinsics", Field,
+                   GF64, GF64ShiftXor, GF128, GF128ShiftXor, GF256,
+                   GF256ShiftXor, GCM::Field) {
+  constexpr Field a = sample<Field>(1), b = sample<Field>(2);
+  constexpr Field product = a * b;
+  constexpr Field square = a.square();
+  constexpr Field inverse = a.modular_inverse();
+  static_assert(product * inverse == b);
+
+  // At runtime, the same operations use PCLMULQDQ where it is available
+  Field runtime_a = sample<Field>(1), runtime_b = sample<Field>(2);
+  CHECK(runtime_a * runtime_b == product);
+  CHECK(runtime_a.square() == square);
+  CHECK(runtime_a.modular_inverse() == inverse);
+}
+
+TEST_CASE("Galois field reductions agree") {
+  static_assert(Galois::default_reduction(0x87) == Galois::Reduction::Clmul);
+  static_assert(Galois::default_reduction(1 << 7 | 1) ==
+                Galois::Reduction::ShiftXor);
+  for (int i = 0; i < 16; ++i) {
+    GF64 a = GF64::random(), b = GF64::random();
+    CHECK((a * b).limbs() ==
+          (GF64ShiftXor(a.limbs()) * GF64ShiftXor(b.limbs())).limbs());
+    GF128 c = GF128::random(), d = GF128::random();
+    CHECK((c * d).limbs() ==
+          (GF128ShiftXor(c.limbs()) * GF128ShiftXor(d.limbs())).limbs());
+    GF256 e = GF256::random(), f = GF256::random();
+    CHECK((e * f).limbs() ==
+          (GF256ShiftXor(e.limbs()) * GF256ShiftXor(f.limbs())).limbs());
+  }
+}
+
+TEST_CASE("Galois GCM field matches GCM::Polynomial") {
+  for (int i = 0; i < 16; ++i) {
+    GCM::Polynomial a = GCM::Polynomial::random();
+    GCM::Polynomial b = GCM::Polynomial::random();
+    CHECK(GCM::Polynomial(a.to_field()) == a);
+    CHECK(GCM::Polynomial(a.to_field() * b.to_field()) == a * b);
+    CHECK(GCM::Polynomial(a.to_field().modular_inverse()) ==
+          a.modular_inverse());
+
+    // The natural order field is the same field with the bits reversed
+    GF128 x = GF128::random(), y = GF128::random();
+    CHECK(reflect(x * y) == reflect(x) * reflect(y));
+  }
+}
+#endif
+
+#ifdef BENCH
+#include "benchmark.hpp"
+
+template <typename Field> static void benchmark_multiply(const char *name) {
+  std::vector<Field> a, b;
+  for (std::size_t i = 0; i < 4096; ++i) {
+    a.push_back(Field::random());
+    b.push_back(Field::random());
+  }
+  std::vector<Field> out(a.size(), Field::zero());
+  Benchmark::throughput(name, a.size() * sizeof(Field), [&]() {
+    for (std::size_t i = 0; i < a.size(); ++i) {
+      out[i] = a[i] * b[i];
+    }
+  });
+}
+
+BENCHMARK_CASE("galois multiplication, 4096 elements") {
+  using Galois::BitOrder::Natural, Galois::Reduction::ShiftXor,
+      Galois::Reduction::Clmul;
+  benchmark_multiply<GCM::Polynomial>("GCM::Polynomial");
+  benchmark_multiply<GCM::Field>("GCM::Field");
+  benchmark_multiply<Galois::Polynomial<64, 0x1b, Natural, ShiftXor>>(
+      "GF(2^64), shift/xor");
+  benchmark_multiply<Galois::Polynomial<64, 0x1b, Natural, Clmul>>(
+      "GF(2^64), clmul");
+  benchmark_multiply<Galois::Polynomial<128, 0x87, Natural, ShiftXor>>(
+      "GF(2^128), shift/xor");
+  benchmark_multiply<Galois::Polynomial<128, 0x87, Natural, Clmul>>(
+      "GF(2^128), clmul");
+  benchmark_multiply<Galois::Polynomial<256, 0x425, Natural, ShiftXor>>(
+      "GF(2^256), shift/xor");
+  benchmark_multiply<Galois::Polynomial<256, 0x425, Natural, Clmul>>(
+      "GF(2^256), clmul");
+}
+#endif
@@ -0,0 +1,72 @@
+#include <cstdint>
+#include <emmintrin.h>
+#include <span>
+#include <wmmintrin.h>
+
+#include "cpu.hpp"
+#include "gcm/aes.hpp"
+
+/// @brief derive the next round key from \p key and the `aeskeygenassist`
+/// output \p assist (FIPS 197, section 5.2)
+CPU_INLINE __m128i next_round_key(__m128i key, __m128i assist) {
+  assist = _mm_shuffle_epi32(assist, _MM_SHUFFLE(3, 3, 3, 3));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  return _mm_xor_si128(key, assist);
+}
+
+/// @brief the round constants are immediates of `aeskeygenassist`, so the
+/// expansion is unrolled at compile time
+template <std::size_t ROUND>
+CPU_TARGET("aes")
+static void expand(GCM::AES::Key128::RoundKeys &keys) {
+  if constexpr (ROUND <= GCM::AES::Key128::ROUNDS) {
+    // x^(ROUND - 1) in GF(2^8)
+    constexpr int RCON = ROUND <= 8 ? 1 << (ROUND - 1) : ROUND == 9 ? 0x1b : 0x36;
+    keys[ROUND] = next_round_key(
+        keys[ROUND - 1], _mm_aeskeygenassist_si128(keys[ROUND - 1], RCON));
+    expand<ROUND + 1>(keys);
+  }
+}
+
+GCM::AES::Key128::Key128(std::span<const std::uint8_t, 16> key) {
+  m_round_keys[0] =
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(key.data()));
+  expand<1>(m_round_keys);
+}
+
+__m128i GCM::AES::Key128::encrypt(__m128i block) const {
+  block = _mm_xor_si128(block, m_round_keys[0]);
+  for (std::size_t round = 1; round < ROUNDS; ++round) {
+    block = _mm_aesenc_si128(block, m_round_keys[round]);
+  }
+  return _mm_aesenclast_si128(block, m_round_keys[ROUNDS]);
+}
+
+#ifdef TEST
+#include "doctest.h"
+#include <botan/hex.h>
+#include <vector>
+
+TEST_CASE("test AES-128 key schedule with the FIPS 197 example") {
+  if (!GCM::AES::aesni()) {
+    return;
+  }
+  std::vector<std::uint8_t> key =
+      Botan::hex_decode("000102030405060708090a0b0c0d0e0f");
+  std::vector<std::uint8_t> block =
+      Botan::hex_decode("00112233445566778899aabbccddeeff");
+  GCM::AES::Key128 aes{std::span(key).first<16>()};
+
+  std::vector<std::uint8_t> last_key(16);
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(last_key.data()),
+                   aes.round_keys()[GCM::AES::Key128::ROUNDS]);
+  CHECK(Botan::hex_encode(last_key) == "13111D7FE3944A17F307A78B4D2B30C5");
+
+  _mm_storeu_si128(
+      reinterpret_cast<__m128i *>(block.data()),
+      aes.encrypt(_mm_loadu_si128(reinterpret_cast<__m128i *>(block.data()))));
+  CHECK(Botan::hex_encode(block) == "69C4E0D86A7B0430D8CDB78070B4C55A");
+}
+#endif
@@ -3,9 +3,12 @@
 #include <cppcodec/base64_default_rfc4648.hpp>
 #include <nlohmann/json.hpp>
 #include <ranges>
+#include <span>
 #include <tuple>
 #include <vector>
 
+#include "cpu.hpp"
+#include "gcm/backend.hpp"
 #include "gcm/cantor_zassenhaus/polynomial.hpp"
 #include "gcm/polynomial.hpp"
 
@@ -29,19 +32,74 @@ GCM::CantorZassenhaus::Polynomial::operator+=(
 
 GCM::CantorZassenhaus::Polynomial GCM::CantorZassenhaus::Polynomial::operator*(
     const GCM::CantorZassenhaus::Polynomial &rhs) {
-  GCM::CantorZassenhaus::Polynomial out(std::vector<GCM::Polynomial>(
-      this->degree() + rhs.degree() + 1, GCM::Polynomial::zero()));
+  if (this->empty() || rhs.empty()) {
+    return GCM::CantorZassenhaus::Polynomial({});
+  }
+  const std::size_t m = this->m_coeffs.size(), n = rhs.m_coeffs.size();
+  GCM::CantorZassenhaus::Polynomial out(
+      std::vector<GCM::Polynomial>(m + n - 1, GCM::Polynomial::zero()));
 
-  for (std::size_t i = 0; i < this->m_coeffs.size(); ++i) {
-    for (std::size_t j = 0; j < rhs.m_coeffs.size(); ++j) {
-      out.coefficient(i + j) += this->m_coeffs.at(i) * rhs.m_coeffs.at(j);
-    }
+  // Coefficient k is the dot product of this[first..last] with
+  // rhs[k-first..k-last], which is a contiguous, ascending range of the
+  // reversed rhs.
+  const std::vector<GCM::Polynomial> reversed(rhs.m_coeffs.rbegin(),
+                                              rhs.m_coeffs.rend());
+  for (std::size_t k = 0; k < out.m_coeffs.size(); ++k) {
+    std::size_t first = k >= n - 1 ? k - (n - 1) : 0;
+    std::size_t count = std::min(k, m - 1) - first + 1;
+    out.m_coeffs[k] = GCM::Polynomial::dot(
+        std::span(this->m_coeffs).subspan(first, count),
+        std::span(reversed).subspan(n - 1 - k + first, count));
   }
 
   out.ensure_normalized();
   return out;
 }
 
+// divmod() and square() pick the backend of their scalar products once, see
+// GCM::Backend::ClmulOps. The products of operator* are all in the dot
+// kernels already.
+
+/// @brief long division of \p remainder by \p divisor , one quotient
+/// coefficient per step. The multiples of the divisor use the batch kernels.
+template <typename Ops>
+__attribute__((always_inline)) static inline void
+divide_with(std::vector<GCM::Polynomial> &remainder,
+            std::span<const GCM::Polynomial> divisor, __m128i leading_inverse,
+            std::span<GCM::Polynomial> quotient) {
+  auto scaled =
+      std::vector<GCM::Polynomial>(divisor.size(), GCM::Polynomial::zero());
+  while (remainder.size() >= divisor.size()) {
+    std::size_t degree = remainder.size() - divisor.size();
+    quotient[degree] =
+        Ops::multiply(remainder.back().to_m128i(), leading_inverse);
+    // remainder -= quotient[degree] * X^degree * divisor
+    GCM::Polynomial::multiply(divisor, quotient[degree], scaled);
+    for (std::size_t i = 0; i < scaled.size(); ++i) {
+      remainder[degree + i] += scaled[i];
+    }
+    while (!remainder.empty() && remainder.back() == GCM::Polynomial::zero()) {
+      remainder.pop_back();
+    }
+  }
+}
+
+CPU_TARGET("pclmul") static void
+divide_pclmul(std::vector<GCM::Polynomial> &remainder,
+              std::span<const GCM::Polynomial> divisor,
+              __m128i leading_inverse, std::span<GCM::Polynomial> quotient) {
+  divide_with<GCM::Backend::ClmulOps>(remainder, divisor, leading_inverse,
+                                      quotient);
+}
+
+static void divide_portable(std::vector<GCM::Polynomial> &remainder,
+                            std::span<const GCM::Polynomial> divisor,
+                            __m128i leading_inverse,
+                            std::span<GCM::Polynomial> quotient) {
+  divide_with<GCM::Backend::TableOps>(remainder, divisor, leading_inverse,
+                                      quotient);
+}
+
 std::tuple<GCM::CantorZassenhaus::Polynomial, GCM::CantorZassenhaus::Polynomial>
 GCM::CantorZassenhaus::Polynomial::divmod(
     GCM::CantorZassenhaus::Polynomial divisor) const {
@@ -53,13 +111,12 @@ GCM::CantorZassenhaus::Polynomial::divmod(
   GCM::CantorZassenhaus::Polynomial q(
       {out_degree + 1, GCM::Polynomial::zero()}),
       r = *this;
-  while (r.degree() >= divisor.degree() && !r.empty()) {
-    std::size_t degree = r.degree() - divisor.degree();
-    q.coefficient(degree) =
-        r.coefficient(r.degree()) / divisor.coefficient(divisor.degree());
-    GCM::CantorZassenhaus::Polynomial factor{{q.coefficient(degree)}};
-    factor <<= degree;
-    r -= factor * divisor;
+  const __m128i leading_inverse =
+      divisor.coefficient(divisor.degree()).modular_inverse().to_m128i();
+  if (GCM::Backend::pclmul()) {
+    divide_pclmul(r.m_coeffs, divisor.m_coeffs, leading_inverse, q.m_coeffs);
+  } else {
+    divide_portable(r.m_coeffs, divisor.m_coeffs, leading_inverse, q.m_coeffs);
   }
   assert(q * divisor + r == *this);
   q.ensure_normalized();
@@ -67,6 +124,45 @@ GCM::CantorZassenhaus::Polynomial::divmod(
   return {q, r};
 }
 
+/// @brief square every coefficient of \p in into the even coefficients of
+/// \p out
+template <typename Ops>
+__attribute__((always_inline)) static inline void
+square_with(std::span<const GCM::Polynomial> in,
+            std::span<GCM::Polynomial> out) {
+  for (std::size_t i = 0; i < in.size(); ++i) {
+    out[2 * i] = Ops::square(in[i].to_m128i());
+  }
+}
+
+CPU_TARGET("pclmul") static void
+square_pclmul(std::span<const GCM::Polynomial> in,
+              std::span<GCM::Polynomial> out) {
+  square_with<GCM::Backend::ClmulOps>(in, out);
+}
+
+static void square_portable(std::span<const GCM::Polynomial> in,
+                            std::span<GCM::Polynomial> out) {
+  square_with<GCM::Backend::TableOps>(in, out);
+}
+
+GCM::CantorZassenhaus::Polynomial
+GCM::CantorZassenhaus::Polynomial::square() const {
+  if (this->empty()) {
+    return GCM::CantorZassenhaus::Polynomial({});
+  }
+  // (sum c_i X^i)^2 = sum c_i^2 X^(2i)
+  GCM::CantorZassenhaus::Polynomial out(std::vector<GCM::Polynomial>(
+      2 * this->m_coeffs.size() - 1, GCM::Polynomial::zero()));
+  if (GCM::Backend::pclmul()) {
+    square_pclmul(this->m_coeffs, out.m_coeffs);
+  } else {
+    square_portable(this->m_coeffs, out.m_coeffs);
+  }
+  out.ensure_normalized();
+  return out;
+}
+
 GCM::CantorZassenhaus::Polynomial GCM::CantorZassenhaus::Polynomial::pow(
     __m128i exponent, GCM::CantorZassenhaus::Polynomial mod) const {
   __m128i lowest_bit = _mm_setr_epi32(0x1, 0, 0, 0);
@@ -80,7 +176,7 @@ GCM::CantorZassenhaus::Polynomial GCM::CantorZassenhaus::Polynomial::pow(
     __m128i carry = _mm_slli_epi32(exponent, 31);
     carry = _mm_srli_si128(carry, 4);
     exponent = _mm_or_si128(shifted, carry);
-    base *= base;
+    base = base.square();
 
     base %= mod;
     out %= mod;
@@ -90,9 +186,11 @@ GCM::CantorZassenhaus::Polynomial GCM::CantorZassenhaus::Polynomial::pow(
 
 void GCM::CantorZassenhaus::Polynomial::ensure_monic() {
   this->ensure_normalized();
-  for (std::size_t i = 0; i < this->m_coeffs.size(); ++i) {
-    this->m_coeffs.at(i) /= this->m_coeffs.back();
+  if (this->empty()) {
+    return;
   }
+  GCM::Polynomial leading_inverse = this->m_coeffs.back().modular_inverse();
+  GCM::Polynomial::multiply(this->m_coeffs, leading_inverse, this->m_coeffs);
 }
 
 void GCM::CantorZassenhaus::Polynomial::ensure_normalized() {
@@ -104,10 +202,8 @@ void GCM::CantorZassenhaus::Polynomial::ensure_normalized() {
 
 GCM::CantorZassenhaus::Polynomial
 GCM::CantorZassenhaus::Polynomial::random(std::size_t degree) {
-  std::vector<GCM::Polynomial> rand;
-  for (std::size_t i = 0; i <= degree; ++i) {
-    rand.push_back(GCM::Polynomial::random());
-  }
+  std::vector<GCM::Polynomial> rand(degree + 1, GCM::Polynomial::zero());
+  GCM::Polynomial::random(rand);
   return GCM::CantorZassenhaus::Polynomial(rand);
 }
 
@@ -115,7 +211,7 @@ nlohmann::json GCM::CantorZassenhaus::Polynomial::to_json() {
   std::vector<std::string> coefficients;
   for (std::size_t i = 0; i < this->m_coeffs.size(); ++i) {
     coefficients.push_back(
-        cppcodec::base64_rfc4648::encode(this->m_coeffs.at(i).to_gcm_bytes()));
+        cppcodec::base64_rfc4648::encode(this->m_coeffs.at(i).to_gcm_block()));
   }
   return nlohmann::json(coefficients);
 }
@@ -178,4 +274,50 @@ TEST_CASE("Cantor-Zassenhaus polynomial exponentation with zero result") {
   auto res = x.pow(_mm_setr_epi32(1000000, 0, 0, 0), mod);
   CHECK(res.empty());
 }
-#endif
\ No newline at end of file
+
+TEST_CASE("Cantor-Zassenhaus polynomial multiplication matches schoolbook") {
+  for (auto [m, n] : {std::pair(1, 1), std::pair(1, 7), std::pair(9, 4),
+                      std::pair(16, 16)}) {
+    auto a = GCM::CantorZassenhaus::Polynomial::random(m - 1);
+    auto b = GCM::CantorZassenhaus::Polynomial::random(n - 1);
+    auto expected = std::vector<GCM::Polynomial>(m + n - 1,
+                                                 GCM::Polynomial::zero());
+    for (int i = 0; i < m; ++i) {
+      for (int j = 0; j < n; ++j) {
+        expected[i + j] += a.coefficient(i) * b.coefficient(j);
+      }
+    }
+    CHECK(a * b == GCM::CantorZassenhaus::Polynomial(expected));
+  }
+  auto empty = GCM::CantorZassenhaus::Polynomial({});
+  CHECK((empty * GCM::CantorZassenhaus::Polynomial::random(3)).empty());
+}
+
+TEST_CASE("Cantor-Zassenhaus polynomial square") {
+  for (std::size_t degree : {0, 1, 5, 12}) {
+    auto a = GCM::CantorZassenhaus::Polynomial::random(degree);
+    CHECK(a.square() == a * a);
+  }
+  CHECK(GCM::CantorZassenhaus::Polynomial({}).square().empty());
+}
+
+TEST_CASE("Cantor-Zassenhaus square and division are the same on both "
+          "backends") {
+  std::vector<GCM::Polynomial> a(13, GCM::Polynomial::zero()),
+      b(6, GCM::Polynomial::zero());
+  GCM::Polynomial::random(a);
+  GCM::Polynomial::random(b);
+  auto dividend = GCM::CantorZassenhaus::Polynomial(a);
+  auto divisor = GCM::CantorZassenhaus::Polynomial(b);
+
+  std::vector<GCM::Polynomial> squared(25, GCM::Polynomial::zero());
+  square_portable(a, squared);
+  CHECK(GCM::CantorZassenhaus::Polynomial(squared) == dividend.square());
+
+  auto [quotient, remainder] = dividend.divmod(divisor);
+  std::vector<GCM::Polynomial> q(8, GCM::Polynomial::zero());
+  divide_portable(a, b, b.back().modular_inverse().to_m128i(), q);
+  CHECK(GCM::CantorZassenhaus::Polynomial(q) == quotient);
+  CHECK(GCM::CantorZassenhaus::Polynomial(a) == remainder);
+}
+#endif
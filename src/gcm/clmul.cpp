@@ -0,0 +1,551 @@
+#include <algorithm>
+#include <cstdint>
+#include <immintrin.h>
+#include <vector>
+
+#include "cpu.hpp"
+#include "gcm/clmul.hpp"
+#include "gcm/table.hpp"
+
+CPU_TARGET("pclmul") void
+GCM::CLMUL::multiply_pclmul(const __m128i *a, const __m128i *b, __m128i *out,
+                            std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    out[i] = GCM::CLMUL::multiply(_mm_loadu_si128(&a[i]),
+                                  _mm_loadu_si128(&b[i]));
+  }
+}
+
+CPU_TARGET("pclmul") void
+GCM::CLMUL::scale_pclmul(const __m128i *a, __m128i scalar, __m128i *out,
+                         std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    out[i] = GCM::CLMUL::multiply(_mm_loadu_si128(&a[i]), scalar);
+  }
+}
+
+CPU_TARGET("pclmul") __m128i
+GCM::CLMUL::dot_pclmul(const __m128i *a, const __m128i *b, std::size_t count) {
+  // Two accumulators keep consecutive XORs independent
+  GCM::CLMUL::Wide even = GCM::CLMUL::zero(), odd = GCM::CLMUL::zero();
+  std::size_t i = 0;
+  for (; i + 1 < count; i += 2) {
+    GCM::CLMUL::accumulate(even, GCM::CLMUL::multiply_wide(a[i], b[i]));
+    GCM::CLMUL::accumulate(odd, GCM::CLMUL::multiply_wide(a[i + 1], b[i + 1]));
+  }
+  if (i < count) {
+    GCM::CLMUL::accumulate(even, GCM::CLMUL::multiply_wide(a[i], b[i]));
+  }
+  GCM::CLMUL::accumulate(even, odd);
+  return GCM::CLMUL::reduce(even);
+}
+
+/// @brief pshufb mask converting between GCM byte order and the register
+/// order of GCM::Polynomial
+static __m128i byte_reverse() {
+  return _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+}
+
+CPU_TARGET("pclmul") __m128i
+GCM::CLMUL::ghash_pclmul(__m128i tag, const std::uint8_t *data,
+                         std::size_t count, const __m128i *powers) {
+  const __m128i reverse = byte_reverse();
+  while (count > 0) {
+    std::size_t group = std::min(count, GCM::CLMUL::GHASH_BLOCKS);
+    const __m128i *group_powers = powers + GCM::CLMUL::GHASH_BLOCKS - group;
+    GCM::CLMUL::Wide sum = GCM::CLMUL::zero();
+    for (std::size_t i = 0; i < group; ++i, data += 16) {
+      __m128i block = _mm_shuffle_epi8(
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(data)), reverse);
+      if (i == 0) {
+        block = _mm_xor_si128(block, tag);
+      }
+      GCM::CLMUL::accumulate(
+          sum, GCM::CLMUL::multiply_wide(block,
+                                         _mm_loadu_si128(&group_powers[i])));
+    }
+    tag = GCM::CLMUL::reduce(sum);
+    count -= group;
+  }
+  return tag;
+}
+
+/// @brief two unreduced products, one per 128-bit lane
+struct Wide256 {
+  __m256i low;
+  __m256i high;
+};
+
+/// @brief GCM::CLMUL::multiply_wide for the two lanes of \p a and \p b
+CPU_TARGET("avx2,pclmul,vpclmulqdq") CPU_INLINE Wide256
+multiply_wide_256(__m256i a, __m256i b) {
+  __m256i low = _mm256_clmulepi64_epi128(a, b, 0x00);
+  __m256i high = _mm256_clmulepi64_epi128(a, b, 0x11);
+  __m256i a_folded = _mm256_xor_si256(a, _mm256_shuffle_epi32(a, 0x4e));
+  __m256i b_folded = _mm256_xor_si256(b, _mm256_shuffle_epi32(b, 0x4e));
+  __m256i middle = _mm256_clmulepi64_epi128(a_folded, b_folded, 0x00);
+  middle = _mm256_xor_si256(middle, _mm256_xor_si256(low, high));
+  return {_mm256_xor_si256(low, _mm256_bslli_epi128(middle, 8)),
+          _mm256_xor_si256(high, _mm256_bsrli_epi128(middle, 8))};
+}
+
+/// @brief GCM::CLMUL::reduce for both lanes of \p product
+CPU_TARGET("avx2,pclmul,vpclmulqdq") CPU_INLINE __m256i
+reduce_256(const Wide256 &product) {
+  __m256i tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8, tmp9;
+  tmp3 = product.low;
+  tmp6 = product.high;
+  tmp7 = _mm256_srli_epi32(tmp3, 31);
+  tmp8 = _mm256_srli_epi32(tmp6, 31);
+  tmp3 = _mm256_slli_epi32(tmp3, 1);
+  tmp6 = _mm256_slli_epi32(tmp6, 1);
+  tmp9 = _mm256_bsrli_epi128(tmp7, 12);
+  tmp8 = _mm256_bslli_epi128(tmp8, 4);
+  tmp7 = _mm256_bslli_epi128(tmp7, 4);
+  tmp3 = _mm256_or_si256(tmp3, tmp7);
+  tmp6 = _mm256_or_si256(tmp6, tmp8);
+  tmp6 = _mm256_or_si256(tmp6, tmp9);
+  tmp7 = _mm256_slli_epi32(tmp3, 31);
+  tmp8 = _mm256_slli_epi32(tmp3, 30);
+  tmp9 = _mm256_slli_epi32(tmp3, 25);
+  tmp7 = _mm256_xor_si256(tmp7, tmp8);
+  tmp7 = _mm256_xor_si256(tmp7, tmp9);
+  tmp8 = _mm256_bsrli_epi128(tmp7, 4);
+  tmp7 = _mm256_bslli_epi128(tmp7, 12);
+  tmp3 = _mm256_xor_si256(tmp3, tmp7);
+  tmp2 = _mm256_srli_epi32(tmp3, 1);
+  tmp4 = _mm256_srli_epi32(tmp3, 2);
+  tmp5 = _mm256_srli_epi32(tmp3, 7);
+  tmp2 = _mm256_xor_si256(tmp2, tmp4);
+  tmp2 = _mm256_xor_si256(tmp2, tmp5);
+  tmp2 = _mm256_xor_si256(tmp2, tmp8);
+  tmp3 = _mm256_xor_si256(tmp3, tmp2);
+  return _mm256_xor_si256(tmp6, tmp3);
+}
+
+/// @brief the sum of the two lanes of \p product
+CPU_TARGET("avx2,pclmul,vpclmulqdq") CPU_INLINE GCM::CLMUL::Wide
+fold_256(const Wide256 &product) {
+  return {_mm_xor_si128(_mm256_castsi256_si128(product.low),
+                        _mm256_extracti128_si256(product.low, 1)),
+          _mm_xor_si128(_mm256_castsi256_si128(product.high),
+                        _mm256_extracti128_si256(product.high, 1))};
+}
+
+CPU_TARGET("avx2,pclmul,vpclmulqdq") void
+GCM::CLMUL::multiply_vpclmul256(const __m128i *a, const __m128i *b,
+                                __m128i *out, std::size_t count) {
+  std::size_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&a[i]));
+    __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&b[i]));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(&out[i]),
+                        reduce_256(multiply_wide_256(x, y)));
+  }
+  GCM::CLMUL::multiply_pclmul(a + i, b + i, out + i, count - i);
+}
+
+CPU_TARGET("avx2,pclmul,vpclmulqdq") void
+GCM::CLMUL::scale_vpclmul256(const __m128i *a, __m128i scalar, __m128i *out,
+                             std::size_t count) {
+  const __m256i y = _mm256_broadcastsi128_si256(scalar);
+  std::size_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&a[i]));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(&out[i]),
+                        reduce_256(multiply_wide_256(x, y)));
+  }
+  GCM::CLMUL::scale_pclmul(a + i, scalar, out + i, count - i);
+}
+
+CPU_TARGET("avx2,pclmul,vpclmulqdq") __m128i
+GCM::CLMUL::dot_vpclmul256(const __m128i *a, const __m128i *b,
+                           std::size_t count) {
+  Wide256 sum = {_mm256_setzero_si256(), _mm256_setzero_si256()};
+  std::size_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&a[i]));
+    __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&b[i]));
+    Wide256 product = multiply_wide_256(x, y);
+    sum.low = _mm256_xor_si256(sum.low, product.low);
+    sum.high = _mm256_xor_si256(sum.high, product.high);
+  }
+  // Fold the lanes and reduce once
+  GCM::CLMUL::Wide total = fold_256(sum);
+  for (; i < count; ++i) {
+    GCM::CLMUL::accumulate(total, GCM::CLMUL::multiply_wide(a[i], b[i]));
+  }
+  return GCM::CLMUL::reduce(total);
+}
+
+/// @brief hash the 2 * \p registers blocks at \p data into \p tag with a
+/// single reduction, \p key_powers holding the matching powers of H
+CPU_TARGET("avx2,pclmul,vpclmulqdq") CPU_INLINE __m128i
+ghash_group_256(__m128i tag, const std::uint8_t *data,
+                const __m256i *key_powers, std::size_t registers) {
+  const __m256i reverse = _mm256_broadcastsi128_si256(byte_reverse());
+  Wide256 sum = {_mm256_setzero_si256(), _mm256_setzero_si256()};
+  for (std::size_t k = 0; k < registers; ++k) {
+    __m256i blocks = _mm256_shuffle_epi8(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + 32 * k)),
+        reverse);
+    if (k == 0) {
+      // The tag is added to the first block, in the low lane
+      blocks = _mm256_xor_si256(blocks,
+                                _mm256_set_m128i(_mm_setzero_si128(), tag));
+    }
+    Wide256 product = multiply_wide_256(blocks, key_powers[k]);
+    sum.low = _mm256_xor_si256(sum.low, product.low);
+    sum.high = _mm256_xor_si256(sum.high, product.high);
+  }
+  return GCM::CLMUL::reduce(fold_256(sum));
+}
+
+/// @brief blocks ghash_vpclmul256 sums up with one reduction once a message
+/// is long enough to pay for the extra key powers
+constexpr std::size_t GHASH_WIDE_BLOCKS_256 = 16;
+
+CPU_TARGET("avx2,pclmul,vpclmulqdq") __m128i
+GCM::CLMUL::ghash_vpclmul256(__m128i tag, const std::uint8_t *data,
+                             std::size_t count, const __m128i *powers) {
+  static_assert(GCM::CLMUL::GHASH_BLOCKS == 8);
+  // key_powers[k] holds H^(16-2k) and H^(15-2k); the last four are the given
+  // powers, the first four are only computed for long messages
+  __m256i key_powers[GHASH_WIDE_BLOCKS_256 / 2];
+  for (std::size_t k = 0; k < 4; ++k) {
+    key_powers[4 + k] =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&powers[2 * k]));
+  }
+  if (count >= GHASH_WIDE_BLOCKS_256) {
+    const __m256i stride = _mm256_broadcastsi128_si256(powers[0]);
+    for (std::size_t k = 0; k < 4; ++k) {
+      key_powers[k] = reduce_256(multiply_wide_256(key_powers[4 + k], stride));
+    }
+  }
+  for (; count >= GHASH_WIDE_BLOCKS_256;
+       count -= GHASH_WIDE_BLOCKS_256, data += 16 * GHASH_WIDE_BLOCKS_256) {
+    tag = ghash_group_256(tag, data, key_powers, 8);
+  }
+  for (; count >= 8; count -= 8, data += 128) {
+    tag = ghash_group_256(tag, data, key_powers + 4, 4);
+  }
+  return GCM::CLMUL::ghash_pclmul(tag, data, count, powers);
+}
+
+// GCC 12 implements the unmasked forms of some AVX-512 intrinsics, including
+// _mm512_castsi512_si256, as a merge into an undefined register, which warns
+// with -Wmaybe-uninitialized. The zero-masked forms with every lane selected
+// compute the same.
+constexpr __mmask16 ALL_DWORDS = 0xffff;
+constexpr __mmask8 ALL_QWORDS = 0xff;
+
+/// @brief four unreduced products, one per 128-bit lane
+struct Wide512 {
+  __m512i low;
+  __m512i high;
+};
+
+/// @brief GCM::CLMUL::multiply_wide for the four lanes of \p a and \p b
+CPU_TARGET("avx512f,avx512bw,pclmul,vpclmulqdq") CPU_INLINE Wide512
+multiply_wide_512(__m512i a, __m512i b) {
+  __m512i low = _mm512_clmulepi64_epi128(a, b, 0x00);
+  __m512i high = _mm512_clmulepi64_epi128(a, b, 0x11);
+  __m512i a_folded = _mm512_xor_si512(
+      a, _mm512_maskz_shuffle_epi32(ALL_DWORDS, a,
+                                      static_cast<_MM_PERM_ENUM>(0x4e)));
+  __m512i b_folded = _mm512_xor_si512(
+      b, _mm512_maskz_shuffle_epi32(ALL_DWORDS, b,
+                                      static_cast<_MM_PERM_ENUM>(0x4e)));
+  __m512i middle = _mm512_clmulepi64_epi128(a_folded, b_folded, 0x00);
+  middle = _mm512_xor_si512(middle, _mm512_xor_si512(low, high));
+  return {_mm512_xor_si512(low, _mm512_bslli_epi128(middle, 8)),
+          _mm512_xor_si512(high, _mm512_bsrli_epi128(middle, 8))};
+}
+
+/// @brief GCM::CLMUL::reduce for all four lanes of \p product
+CPU_TARGET("avx512f,avx512bw,pclmul,vpclmulqdq") CPU_INLINE __m512i
+reduce_512(const Wide512 &product) {
+  __m512i tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8, tmp9;
+  tmp3 = product.low;
+  tmp6 = product.high;
+  tmp7 = _mm512_maskz_srli_epi32(ALL_DWORDS, tmp3, 31);
+  tmp8 = _mm512_maskz_srli_epi32(ALL_DWORDS, tmp6, 31);
+  tmp3 = _mm512_maskz_slli_epi32(ALL_DWORDS, tmp3, 1);
+  tmp6 = _mm512_maskz_slli_epi32(ALL_DWORDS, tmp6, 1);
+  tmp9 = _mm512_bsrli_epi128(tmp7, 12);
+  tmp8 = _mm512_bslli_epi128(tmp8, 4);
+  tmp7 = _mm512_bslli_epi128(tmp7, 4);
+  tmp3 = _mm512_or_si512(tmp3, tmp7);
+  tmp6 = _mm512_or_si512(tmp6, tmp8);
+  tmp6 = _mm512_or_si512(tmp6, tmp9);
+  tmp7 = _mm512_maskz_slli_epi32(ALL_DWORDS, tmp3, 31);
+  tmp8 = _mm512_maskz_slli_epi32(ALL_DWORDS, tmp3, 30);
+  tmp9 = _mm512_maskz_slli_epi32(ALL_DWORDS, tmp3, 25);
+  tmp7 = _mm512_xor_si512(tmp7, tmp8);
+  tmp7 = _mm512_xor_si512(tmp7, tmp9);
+  tmp8 = _mm512_bsrli_epi128(tmp7, 4);
+  tmp7 = _mm512_bslli_epi128(tmp7, 12);
+  tmp3 = _mm512_xor_si512(tmp3, tmp7);
+  tmp2 = _mm512_maskz_srli_epi32(ALL_DWORDS, tmp3, 1);
+  tmp4 = _mm512_maskz_srli_epi32(ALL_DWORDS, tmp3, 2);
+  tmp5 = _mm512_maskz_srli_epi32(ALL_DWORDS, tmp3, 7);
+  tmp2 = _mm512_xor_si512(tmp2, tmp4);
+  tmp2 = _mm512_xor_si512(tmp2, tmp5);
+  tmp2 = _mm512_xor_si512(tmp2, tmp8);
+  tmp3 = _mm512_xor_si512(tmp3, tmp2);
+  return _mm512_xor_si512(tmp6, tmp3);
+}
+
+/// @brief the sum of the four lanes of \p product
+CPU_TARGET("avx512f,avx512bw,pclmul,vpclmulqdq") CPU_INLINE GCM::CLMUL::Wide
+fold_512(const Wide512 &product) {
+  __m256i low = _mm256_xor_si256(
+      _mm512_maskz_extracti64x4_epi64(ALL_QWORDS, product.low, 0),
+      _mm512_maskz_extracti64x4_epi64(ALL_QWORDS, product.low, 1));
+  __m256i high = _mm256_xor_si256(
+      _mm512_maskz_extracti64x4_epi64(ALL_QWORDS, product.high, 0),
+      _mm512_maskz_extracti64x4_epi64(ALL_QWORDS, product.high, 1));
+  return {_mm_xor_si128(_mm256_castsi256_si128(low),
+                        _mm256_extracti128_si256(low, 1)),
+          _mm_xor_si128(_mm256_castsi256_si128(high),
+                        _mm256_extracti128_si256(high, 1))};
+}
+
+CPU_TARGET("avx512f,avx512bw,pclmul,vpclmulqdq") void
+GCM::CLMUL::multiply_vpclmul512(const __m128i *a, const __m128i *b,
+                                __m128i *out, std::size_t count) {
+  std::size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m512i x = _mm512_loadu_si512(&a[i]);
+    __m512i y = _mm512_loadu_si512(&b[i]);
+    _mm512_storeu_si512(&out[i], reduce_512(multiply_wide_512(x, y)));
+  }
+  GCM::CLMUL::multiply_pclmul(a + i, b + i, out + i, count - i);
+}
+
+CPU_TARGET("avx512f,avx512bw,pclmul,vpclmulqdq") void
+GCM::CLMUL::scale_vpclmul512(const __m128i *a, __m128i scalar, __m128i *out,
+                             std::size_t count) {
+  const __m512i y = _mm512_maskz_broadcast_i32x4(ALL_DWORDS, scalar);
+  std::size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m512i x = _mm512_loadu_si512(&a[i]);
+    _mm512_storeu_si512(&out[i], reduce_512(multiply_wide_512(x, y)));
+  }
+  GCM::CLMUL::scale_pclmul(a + i, scalar, out + i, count - i);
+}
+
+CPU_TARGET("avx512f,avx512bw,pclmul,vpclmulqdq") __m128i
+GCM::CLMUL::dot_vpclmul512(const __m128i *a, const __m128i *b,
+                           std::size_t count) {
+  Wide512 sum = {_mm512_setzero_si512(), _mm512_setzero_si512()};
+  std::size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    Wide512 product = multiply_wide_512(_mm512_loadu_si512(&a[i]),
+                                        _mm512_loadu_si512(&b[i]));
+    sum.low = _mm512_xor_si512(sum.low, product.low);
+    sum.high = _mm512_xor_si512(sum.high, product.high);
+  }
+  // Fold the lanes and reduce once
+  GCM::CLMUL::Wide total = fold_512(sum);
+  for (; i < count; ++i) {
+    GCM::CLMUL::accumulate(total, GCM::CLMUL::multiply_wide(a[i], b[i]));
+  }
+  return GCM::CLMUL::reduce(total);
+}
+
+/// @brief hash the 4 * \p registers blocks at \p data into \p tag with a
+/// single reduction, \p key_powers holding the matching powers of H
+CPU_TARGET("avx512f,avx512bw,pclmul,vpclmulqdq") CPU_INLINE __m128i
+ghash_group_512(__m128i tag, const std::uint8_t *data,
+                const __m512i *key_powers, std::size_t registers) {
+  const __m512i reverse = _mm512_maskz_broadcast_i32x4(ALL_DWORDS,
+                                                       byte_reverse());
+  // Broadcasting to the lowest lane only adds the tag to the first block
+  constexpr __mmask16 FIRST_LANE = 0x000f;
+  Wide512 sum = {_mm512_setzero_si512(), _mm512_setzero_si512()};
+  for (std::size_t k = 0; k < registers; ++k) {
+    __m512i blocks =
+        _mm512_shuffle_epi8(_mm512_loadu_si512(data + 64 * k), reverse);
+    if (k == 0) {
+      blocks = _mm512_xor_si512(
+          blocks, _mm512_maskz_broadcast_i32x4(FIRST_LANE, tag));
+    }
+    Wide512 product = multiply_wide_512(blocks, key_powers[k]);
+    sum.low = _mm512_xor_si512(sum.low, product.low);
+    sum.high = _mm512_xor_si512(sum.high, product.high);
+  }
+  return GCM::CLMUL::reduce(fold_512(sum));
+}
+
+/// @brief blocks ghash_vpclmul512 sums up with one reduction once a message
+/// is long enough to pay for the extra key powers
+constexpr std::size_t GHASH_WIDE_BLOCKS_512 = 32;
+
+CPU_TARGET("avx512f,avx512bw,pclmul,vpclmulqdq") __m128i
+GCM::CLMUL::ghash_vpclmul512(__m128i tag, const std::uint8_t *data,
+                             std::size_t count, const __m128i *powers) {
+  static_assert(GCM::CLMUL::GHASH_BLOCKS == 8);
+  // key_powers[k] holds H^(32-4k)..H^(29-4k); the last two are the given
+  // powers, the first six are only computed for long messages
+  __m512i key_powers[GHASH_WIDE_BLOCKS_512 / 4];
+  key_powers[6] = _mm512_loadu_si512(&powers[0]);
+  key_powers[7] = _mm512_loadu_si512(&powers[4]);
+  if (count >= GHASH_WIDE_BLOCKS_512) {
+    const __m512i stride = _mm512_maskz_broadcast_i32x4(ALL_DWORDS, powers[0]);
+    for (std::size_t k = 6; k-- > 0;) {
+      key_powers[k] = reduce_512(multiply_wide_512(key_powers[k + 2], stride));
+    }
+  }
+  for (; count >= GHASH_WIDE_BLOCKS_512;
+       count -= GHASH_WIDE_BLOCKS_512, data += 16 * GHASH_WIDE_BLOCKS_512) {
+    tag = ghash_group_512(tag, data, key_powers, 8);
+  }
+  for (; count >= 8; count -= 8, data += 128) {
+    tag = ghash_group_512(tag, data, key_powers + 6, 2);
+  }
+  return GCM::CLMUL::ghash_pclmul(tag, data, count, powers);
+}
+
+std::vector<GCM::CLMUL::Kernels> GCM::CLMUL::supported_kernels() {
+  const CPU::Features &features = CPU::features();
+  std::vector<GCM::CLMUL::Kernels> kernels;
+  if (features.pclmul && features.vpclmulqdq && features.avx512f &&
+      features.avx512bw) {
+    kernels.push_back({"vpclmulqdq512", GCM::CLMUL::multiply_vpclmul512,
+                       GCM::CLMUL::scale_vpclmul512, GCM::CLMUL::dot_vpclmul512,
+                       GCM::CLMUL::ghash_vpclmul512});
+  }
+  if (features.pclmul && features.vpclmulqdq && features.avx2) {
+    kernels.push_back({"vpclmulqdq256", GCM::CLMUL::multiply_vpclmul256,
+                       GCM::CLMUL::scale_vpclmul256, GCM::CLMUL::dot_vpclmul256,
+                       GCM::CLMUL::ghash_vpclmul256});
+  }
+  if (features.pclmul) {
+    kernels.push_back({"pclmul", GCM::CLMUL::multiply_pclmul,
+                       GCM::CLMUL::scale_pclmul, GCM::CLMUL::dot_pclmul,
+                       GCM::CLMUL::ghash_pclmul});
+  }
+  kernels.push_back({"table", GCM::Table::multiply_kernel,
+                     GCM::Table::scale_kernel, GCM::Table::dot_kernel,
+                     GCM::Table::ghash_kernel});
+  return kernels;
+}
+
+const GCM::CLMUL::Kernels &GCM::CLMUL::best_kernels() {
+  static const GCM::CLMUL::Kernels best =
+      GCM::CLMUL::supported_kernels().front();
+  return best;
+}
+
+#ifdef TEST
+#include <random>
+
+#include "doctest.h"
+#include "gcm/polynomial.hpp"
+
+/// @brief the kernels work on plain registers, a std::vector<__m128i> would
+/// drop the alignment attributes of the type
+static const __m128i *registers(const std::vector<GCM::Polynomial> &v) {
+  return reinterpret_cast<const __m128i *>(v.data());
+}
+
+TEST_CASE("test every clmul kernel matches the scalar multiplication") {
+  std::mt19937_64 gen(5);
+  // Odd sizes to cover the tails of the wide kernels
+  for (std::size_t count : {0, 1, 3, 4, 9, 31}) {
+    std::vector<GCM::Polynomial> a, b;
+    for (std::size_t i = 0; i < count; ++i) {
+      a.emplace_back(gen(), gen());
+      b.emplace_back(gen(), gen());
+    }
+    const GCM::Polynomial scalar(gen(), gen());
+
+    std::vector<GCM::Polynomial> products, scaled;
+    GCM::Polynomial sum = GCM::Polynomial::zero();
+    for (std::size_t i = 0; i < count; ++i) {
+      products.push_back(a[i] * b[i]);
+      scaled.push_back(a[i] * scalar);
+      sum += products[i];
+    }
+
+    for (const GCM::CLMUL::Kernels &kernels : GCM::CLMUL::supported_kernels()) {
+      INFO("kernel " << kernels.name << ", " << count << " elements");
+      std::vector<GCM::Polynomial> out(count, GCM::Polynomial::zero());
+      __m128i *out_registers = reinterpret_cast<__m128i *>(out.data());
+      kernels.multiply(registers(a), registers(b), out_registers, count);
+      CHECK(out == products);
+      kernels.scale(registers(a), scalar.to_m128i(), out_registers, count);
+      CHECK(out == scaled);
+      CHECK(GCM::Polynomial(kernels.dot(registers(a), registers(b), count)) ==
+            sum);
+    }
+  }
+}
+
+TEST_CASE("test every ghash kernel matches block-wise horner") {
+  std::mt19937_64 gen(6);
+  const GCM::Polynomial key(gen(), gen());
+  // H^GHASH_BLOCKS..H
+  std::vector<GCM::Polynomial> powers(GCM::CLMUL::GHASH_BLOCKS, key);
+  for (std::size_t i = GCM::CLMUL::GHASH_BLOCKS - 1; i-- > 0;) {
+    powers[i] = powers[i + 1] * key;
+  }
+  // Counts around the group sizes to cover every loop of the wide kernels
+  for (std::size_t count : {0, 1, 7, 8, 9, 16, 31, 32, 47, 75}) {
+    std::vector<std::uint8_t> data(count * 16);
+    for (std::uint8_t &byte : data) {
+      byte = static_cast<std::uint8_t>(gen());
+    }
+    const GCM::Polynomial start(gen(), gen());
+
+    GCM::Polynomial expected = start;
+    for (std::size_t i = 0; i < count; ++i) {
+      expected += GCM::Polynomial::from_gcm_bytes(
+          std::span<const std::uint8_t, 16>(data.data() + i * 16, 16));
+      expected *= key;
+    }
+
+    for (const GCM::CLMUL::Kernels &kernels : GCM::CLMUL::supported_kernels()) {
+      INFO("kernel " << kernels.name << ", " << count << " blocks");
+      CHECK(GCM::Polynomial(kernels.ghash(start.to_m128i(), data.data(), count,
+                                          registers(powers))) == expected);
+    }
+  }
+}
+#endif
+
+#ifdef BENCH
+#include <random>
+#include <string>
+
+#include "benchmark.hpp"
+#include "gcm/polynomial.hpp"
+
+BENCHMARK_CASE("gf128 clmul kernels, 4096 elements") {
+  std::mt19937_64 gen(42);
+  std::vector<GCM::Polynomial> a, b, out(4096, GCM::Polynomial::zero());
+  for (std::size_t i = 0; i < out.size(); ++i) {
+    a.emplace_back(gen(), gen());
+    b.emplace_back(gen(), gen());
+  }
+  const __m128i *x = reinterpret_cast<const __m128i *>(a.data());
+  const __m128i *y = reinterpret_cast<const __m128i *>(b.data());
+  __m128i *products = reinterpret_cast<__m128i *>(out.data());
+  const std::size_t bytes = a.size() * sizeof(__m128i);
+  for (const GCM::CLMUL::Kernels &kernels : GCM::CLMUL::supported_kernels()) {
+    Benchmark::throughput(
+        std::string("multiply, ") + kernels.name, bytes,
+        [&]() { kernels.multiply(x, y, products, a.size()); });
+    Benchmark::throughput(std::string("dot, ") + kernels.name, bytes, [&]() {
+      out[0] += GCM::Polynomial(kernels.dot(x, y, a.size()));
+    });
+    Benchmark::throughput(std::string("ghash, ") + kernels.name, bytes, [&]() {
+      out[0] = GCM::Polynomial(
+          kernels.ghash(out[0].to_m128i(),
+                        reinterpret_cast<const std::uint8_t *>(a.data()),
+                        a.size(), y));
+    });
+  }
+}
+#endif
@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <botan/block_cipher.h>
+#include <cassert>
+#include <cstdint>
+#include <emmintrin.h>
+#include <smmintrin.h>
+#include <span>
+#include <vector>
+
+#include "bytemanipulation.hpp"
+#include "gcm/counter_mode.hpp"
+#include "gcm/ghash.hpp"
+
+std::vector<std::uint8_t> GCM::derive_y0(const Botan::BlockCipher &cipher,
+                                         std::span<const std::uint8_t> nonce) {
+  assert(cipher.block_size() == 16 &&
+         "GCM is only implemented for ciphers with 16-byte blocks.");
+  if (nonce.size() == 12) {
+    std::vector<std::uint8_t> y0(nonce.begin(), nonce.end());
+    y0.resize(16, 0);
+    y0.back() = 1;
+    return y0;
+  }
+  std::vector<std::uint8_t> auth_key(16);
+  cipher.encrypt(auth_key);
+  return GCM::ghash(nonce, {}, auth_key);
+}
+
+GCM::CounterMode::CounterMode(const Botan::BlockCipher &cipher,
+                              std::span<const std::uint8_t, 16> y0,
+                              std::uint32_t y)
+    : m_cipher(cipher),
+      m_y0_block(_mm_loadu_si128(reinterpret_cast<const __m128i *>(y0.data()))),
+      m_y0_counter(ByteManipulation::from_bytes<std::uint32_t>(
+          std::vector<std::uint8_t>(y0.begin() + 12, y0.end()),
+          std::endian::big)),
+      m_y(y), m_keystream_used(16) {}
+
+std::vector<std::uint8_t> GCM::CounterMode::y_block(std::uint32_t y) const {
+  std::vector<std::uint8_t> block(16);
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(block.data()), m_y0_block);
+  block.resize(12);
+  ByteManipulation::append_as_bytes<std::uint32_t>(m_y0_counter + y,
+                                                   std::endian::big, block);
+  return block;
+}
+
+void GCM::CounterMode::keystream(std::span<std::uint8_t> out) {
+  assert(out.size() % 16 == 0 && out.size() <= 16 * KEYSTREAM_BLOCKS);
+  // The counter blocks are Y0 with the big endian counter in its last four
+  // bytes replaced, which is a single insert per block
+  for (std::size_t i = 0; i < out.size(); i += 16) {
+    std::uint32_t counter = m_y0_counter + m_y++;
+    __m128i block = _mm_insert_epi32(
+        m_y0_block, static_cast<int>(__builtin_bswap32(counter)), 3);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out.data() + i), block);
+  }
+  m_cipher.encrypt_n(out.data(), out.data(), out.size() / 16);
+}
+
+void GCM::CounterMode::apply(std::span<const std::uint8_t> input,
+                             std::span<std::uint8_t> output) {
+  assert(input.size() == output.size());
+  std::size_t i = 0;
+  // Use up the keystream of the previous partial block
+  for (; i < input.size() && m_keystream_used < 16; ++i) {
+    output[i] = input[i] ^ m_keystream[m_keystream_used++];
+  }
+
+  alignas(16) std::array<std::uint8_t, 16 * KEYSTREAM_BLOCKS> keystream;
+  while (input.size() - i >= 16) {
+    std::size_t bytes = std::min(keystream.size(), (input.size() - i) & ~15);
+    this->keystream(std::span(keystream).first(bytes));
+    for (std::size_t j = 0; j < bytes; j += 16) {
+      __m128i block =
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(&input[i + j]));
+      __m128i key = _mm_load_si128(reinterpret_cast<__m128i *>(&keystream[j]));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(&output[i + j]),
+                       _mm_xor_si128(block, key));
+    }
+    i += bytes;
+  }
+
+  if (i < input.size()) {
+    this->keystream(m_keystream);
+    m_keystream_used = 0;
+    for (; i < input.size(); ++i) {
+      output[i] = input[i] ^ m_keystream[m_keystream_used++];
+    }
+  }
+}
+
+void GCM::CounterMode::skip_blocks(std::uint32_t blocks) {
+  assert(m_keystream_used == 16 && "Cannot skip blocks in a partial block");
+  m_y += blocks;
+}
+
+GCM::CounterMode GCM::CounterMode::fork(std::uint32_t blocks) const {
+  GCM::CounterMode copy = *this;
+  copy.skip_blocks(blocks);
+  return copy;
+}
+
+#ifdef TEST
+#include "doctest.h"
+#include <botan/hex.h>
+
+TEST_CASE("test counter mode at an offset continues the keystream") {
+  auto aes = Botan::BlockCipher::create_or_throw("AES-128");
+  aes->set_key(Botan::hex_decode("feffe9928665731c6d6a8f9467308308"));
+  std::vector<std::uint8_t> y0 =
+      GCM::derive_y0(*aes, Botan::hex_decode("cafebabefacedbaddecaf888"));
+  CHECK(Botan::hex_encode(y0) == "CAFEBABEFACEDBADDECAF88800000001");
+
+  std::vector<std::uint8_t> message(16 * 40 + 5, 0);
+  GCM::CounterMode whole(*aes, std::span(y0).first<16>());
+  whole.apply(message, message);
+
+  // Starting at block 33, as a thread of a parallel encryption would
+  std::vector<std::uint8_t> tail(message.size() - 16 * 33, 0);
+  GCM::CounterMode offset(*aes, std::span(y0).first<16>(), 1 + 33);
+  offset.apply(tail, tail);
+  CHECK(std::equal(tail.begin(), tail.end(), message.begin() + 16 * 33));
+  std::fill(tail.begin(), tail.end(), 0);
+  GCM::CounterMode(*aes, std::span(y0).first<16>()).fork(33).apply(tail, tail);
+  CHECK(std::equal(tail.begin(), tail.end(), message.begin() + 16 * 33));
+
+  // Skipping blocks, as after a kernel which encrypts them itself
+  std::vector<std::uint8_t> skipped(message.size(), 0);
+  GCM::CounterMode skipping(*aes, std::span(y0).first<16>());
+  skipping.apply(std::span(skipped).first(32), std::span(skipped).first(32));
+  CHECK(skipping.remaining_keystream() == 0);
+  skipping.skip_blocks(31);
+  skipping.apply(std::span(skipped).subspan(16 * 33),
+                 std::span(skipped).subspan(16 * 33));
+  CHECK(std::equal(skipped.begin() + 16 * 33, skipped.end(),
+                   message.begin() + 16 * 33));
+}
+#endif
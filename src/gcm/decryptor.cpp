@@ -0,0 +1,112 @@
+#include <botan/block_cipher.h>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <span>
+#include <vector>
+
+#include "gcm/counter_mode.hpp"
+#include "gcm/decryptor.hpp"
+#include "gcm/ghash.hpp"
+#include "stream.hpp"
+
+/// @brief the auth key `H = E(0)`
+static std::vector<std::uint8_t> auth_key(const Botan::BlockCipher &cipher) {
+  std::vector<std::uint8_t> key(16);
+  cipher.encrypt(key);
+  return key;
+}
+
+GCM::Decryptor::Decryptor(std::span<const std::uint8_t> associated_data,
+                          std::unique_ptr<Botan::BlockCipher> cipher,
+                          std::span<const std::uint8_t> nonce)
+    : m_cipher(std::move(cipher)), m_y0(GCM::derive_y0(*m_cipher, nonce)),
+      m_ctr(*m_cipher, std::span(m_y0).first<16>()),
+      m_hasher(associated_data, auth_key(*m_cipher)) {}
+
+void GCM::Decryptor::update(std::span<const std::uint8_t> ciphertext,
+                            std::span<std::uint8_t> plaintext) {
+  // Hash first, the plaintext may overwrite the ciphertext
+  m_hasher.update(ciphertext);
+  m_ctr.apply(ciphertext, plaintext);
+}
+
+std::uint64_t GCM::Decryptor::process_stream(std::istream &input,
+                                             std::ostream &output) {
+  return Stream::transform(input, output,
+                           [this](std::span<const std::uint8_t> ciphertext,
+                                  std::span<std::uint8_t> plaintext) {
+                             this->update(ciphertext, plaintext);
+                           });
+}
+
+bool GCM::Decryptor::verify(std::span<const std::uint8_t> auth_tag) {
+  std::vector<std::uint8_t> expected = m_hasher.finalize();
+  std::vector<std::uint8_t> mask = m_ctr.y_block(0);
+  m_cipher->encrypt(mask);
+  if (auth_tag.size() != expected.size()) {
+    return false;
+  }
+  // No early exit, so that the time does not depend on the first difference
+  std::uint8_t difference = 0;
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    difference |= expected[i] ^ mask[i] ^ auth_tag[i];
+  }
+  return difference == 0;
+}
+
+#ifdef TEST
+#include "doctest.h"
+#include <botan/hex.h>
+#include <sstream>
+
+#include "gcm/encryptor.hpp"
+
+TEST_CASE("test streaming decryption of an encrypted message") {
+  std::vector<std::uint8_t> key =
+      Botan::hex_decode("feffe9928665731c6d6a8f9467308308");
+  std::vector<std::uint8_t> associated_data(20, 0xab);
+  std::vector<std::uint8_t> plaintext(Stream::CHUNK_SIZE * 2 + 123);
+  for (std::size_t i = 0; i < plaintext.size(); ++i) {
+    plaintext[i] = i * 11 + (i >> 12);
+  }
+
+  for (const char *nonce : {"cafebabefacedbaddecaf888", "cafebabefacedbad"}) {
+    GCM::Encryptor encryptor(associated_data, key, Botan::hex_decode(nonce));
+    std::vector<std::uint8_t> ciphertext = encryptor.update(plaintext);
+    std::vector<std::uint8_t> auth_tag = encryptor.finalize();
+
+    auto decryptor = [&]() {
+      auto aes = Botan::BlockCipher::create_or_throw("AES-128");
+      aes->set_key(key);
+      return GCM::Decryptor(associated_data, std::move(aes),
+                            Botan::hex_decode(nonce));
+    };
+    std::istringstream input(
+        std::string(ciphertext.begin(), ciphertext.end()));
+    std::ostringstream output;
+    GCM::Decryptor streaming = decryptor();
+    CHECK(streaming.process_stream(input, output) == plaintext.size());
+    std::string decrypted = output.str();
+    CHECK(std::vector<std::uint8_t>(decrypted.begin(), decrypted.end()) ==
+          plaintext);
+    CHECK(streaming.verify(auth_tag));
+
+    // A modified ciphertext, a modified tag and a truncated tag are rejected
+    GCM::Decryptor modified = decryptor();
+    ciphertext[12345] ^= 1;
+    modified.update(ciphertext);
+    CHECK_FALSE(modified.verify(auth_tag));
+    ciphertext[12345] ^= 1;
+
+    GCM::Decryptor wrong_tag = decryptor();
+    wrong_tag.update(ciphertext);
+    auth_tag[15] ^= 0x80;
+    CHECK_FALSE(wrong_tag.verify(auth_tag));
+
+    GCM::Decryptor truncated = decryptor();
+    truncated.update(ciphertext);
+    CHECK_FALSE(truncated.verify(std::span(auth_tag).first(12)));
+  }
+}
+#endif
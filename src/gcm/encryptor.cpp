@@ -5,30 +5,56 @@
 #include <functional>
 #include <iostream>
 #include <iterator>
+#include <smmintrin.h>
+#include <span>
 #include <stdexcept>
+#include <vector>
+#include <wmmintrin.h>
 
-#include "bytemanipulation.hpp"
+#include "cpu.hpp"
+#include "gcm/aes.hpp"
+#include "gcm/backend.hpp"
+#include "gcm/clmul.hpp"
+#include "gcm/counter_mode.hpp"
 #include "gcm/encryptor.hpp"
 #include "gcm/ghash.hpp"
 #include "gcm/polynomial.hpp"
+#include "parallel.hpp"
 
 GCM::Encryptor::Encryptor(std::vector<std::uint8_t> associated_data,
                           std::unique_ptr<Botan::BlockCipher> cipher,
                           const std::vector<std::uint8_t> &nonce)
-    : m_cipher(std::move(cipher)), m_y(1),
-      m_hasher(associated_data, this->h()) {
-  // SAFETY: This requirement is used in GCM::Encryptor::ghash.
-  assert(m_cipher->block_size() == 16 &&
-         "GCM is only implemented for ciphers with 16-byte blocks.");
-  if (nonce.size() == 12) {
-    m_y0 = nonce;
-    m_y0.resize(this->m_cipher->block_size(), 0);
-    m_y0.back() = 1;
-  } else {
-    m_y0 = GCM::ghash(nonce, {}, this->h());
+    : m_cipher(std::move(cipher)), m_y0(GCM::derive_y0(*m_cipher, nonce)),
+      m_ctr(*m_cipher, std::span(m_y0).first<16>()),
+      m_hasher(associated_data, this->h()) {}
+
+/// @brief create the Botan cipher for the AES-128 constructor
+static std::unique_ptr<Botan::BlockCipher>
+aes_128(std::span<const std::uint8_t> key) {
+  auto aes = Botan::BlockCipher::create_or_throw("AES-128");
+  aes->set_key(key.data(), key.size());
+  return aes;
+}
+
+GCM::Encryptor::Encryptor(std::vector<std::uint8_t> associated_data,
+                          std::span<const std::uint8_t> aes_128_key,
+                          const std::vector<std::uint8_t> &nonce, Mode mode)
+    : Encryptor(std::move(associated_data), aes_128(aes_128_key), nonce) {
+  // Botan has validated the key length
+  if (mode == Mode::Stitched && GCM::AES::aesni() && GCM::Backend::pclmul()) {
+    m_aes_128_key.emplace();
+    std::copy_n(aes_128_key.begin(), 16, m_aes_128_key->begin());
   }
 }
 
+const GCM::AES::Key128 &GCM::Encryptor::stitched_key() {
+  assert(m_aes_128_key && "Only Mode::Stitched has round keys");
+  if (!m_stitched_key) {
+    m_stitched_key.emplace(*m_aes_128_key);
+  }
+  return *m_stitched_key;
+}
+
 std::vector<std::uint8_t> GCM::Encryptor::y0() { return this->m_y0; }
 
 std::vector<std::uint8_t> GCM::Encryptor::h() {
@@ -37,30 +63,184 @@ std::vector<std::uint8_t> GCM::Encryptor::h() {
   return auth_key;
 }
 
-std::vector<std::uint8_t> GCM::Encryptor::y_block(std::uint32_t y) {
-  std::vector<std::uint8_t> block(m_y0.begin(), m_y0.begin() + 12);
-  std::vector<std::uint8_t> val_bytes(m_y0.begin() + 12, m_y0.end());
-  std::uint32_t val =
-      ByteManipulation::from_bytes<std::uint32_t>(val_bytes, std::endian::big);
-  val += y;
-  ByteManipulation::append_as_bytes(val, std::endian::big, block);
-  return block;
-}
-
-std::vector<std::uint8_t>
-GCM::Encryptor::update(std::vector<std::uint8_t> plaintext) {
-  std::vector<std::uint8_t> ciphertext;
-  for (const std::uint8_t &pt : plaintext) {
-    if (m_keystream.size() == 0) {
-      // No bytes left in the keystream so we need to encrypt a new block
-      m_keystream = this->y_block(m_y++);
-      this->m_cipher->encrypt(m_keystream);
+/// @brief the number of blocks per step of the stitched kernel, one for each
+/// key power of GCM::GHASH
+constexpr std::size_t STITCHED_BLOCKS = GCM::GHASH::AGGREGATED_BLOCKS;
+
+/// @brief encrypt and hash \p groups times STITCHED_BLOCKS blocks in CTR mode.
+/// While the AES rounds of one group run, the ciphertext of the previous group
+/// is multiplied by the key powers, so the AES and PCLMULQDQ units work in
+/// parallel and every ciphertext block is hashed straight from its register.
+/// @param first_counter the counter of the first block, which is inserted into
+/// \p y0_block big endian
+/// @param in the plaintext
+/// @param out the ciphertext, may alias \p in
+/// @param tag the GHASH tag before the blocks
+/// @param powers the powers `H^STITCHED_BLOCKS, ..., H^2, H` of the auth key
+/// @return the GHASH tag after the blocks
+CPU_TARGET("aes,pclmul") static __m128i
+encrypt_stitched(const GCM::AES::Key128 &key, __m128i y0_block,
+                 std::uint32_t first_counter, const std::uint8_t *in,
+                 std::uint8_t *out, std::size_t groups, __m128i tag,
+                 std::span<const GCM::Polynomial> powers) {
+  assert(powers.size() == STITCHED_BLOCKS);
+  constexpr std::size_t ROUNDS = GCM::AES::Key128::ROUNDS;
+  const __m128i reverse =
+      _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+  const GCM::AES::Key128::RoundKeys &round_keys = key.round_keys();
+  __m128i h[STITCHED_BLOCKS];
+#pragma GCC unroll 8
+  for (std::size_t j = 0; j < STITCHED_BLOCKS; ++j) {
+    h[j] = powers[j].to_m128i();
+  }
+
+  // The ciphertext of the previous group in register order, with the tag
+  // before that group added to its first block
+  __m128i previous[STITCHED_BLOCKS]{};
+  std::uint32_t counter = first_counter;
+  for (std::size_t group = 0; group < groups; ++group) {
+    // Everything per group is unrolled, so that the blocks stay in registers
+    __m128i blocks[STITCHED_BLOCKS];
+#pragma GCC unroll 8
+    for (__m128i &block : blocks) {
+      block = _mm_xor_si128(
+          _mm_insert_epi32(y0_block,
+                           static_cast<int>(__builtin_bswap32(counter++)), 3),
+          round_keys[0]);
+    }
+
+    GCM::CLMUL::Wide sum = GCM::CLMUL::zero();
+#pragma GCC unroll 16
+    for (std::size_t round = 1; round < ROUNDS; ++round) {
+#pragma GCC unroll 8
+      for (__m128i &block : blocks) {
+        block = _mm_aesenc_si128(block, round_keys[round]);
+      }
+      if (group > 0 && round <= STITCHED_BLOCKS) {
+        GCM::CLMUL::accumulate(sum,
+                               GCM::CLMUL::multiply_wide(previous[round - 1],
+                                                         h[round - 1]));
+      }
+    }
+    if (group > 0) {
+      tag = GCM::CLMUL::reduce(sum);
+    }
+
+#pragma GCC unroll 8
+    for (std::size_t j = 0; j < STITCHED_BLOCKS; ++j, in += 16, out += 16) {
+      __m128i ciphertext = _mm_xor_si128(
+          _mm_aesenclast_si128(blocks[j], round_keys[ROUNDS]),
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(in)));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out), ciphertext);
+      previous[j] = _mm_shuffle_epi8(ciphertext, reverse);
     }
-    ciphertext.push_back(pt ^ m_keystream.at(0));
-    m_keystream.erase(m_keystream.begin());
+    previous[0] = _mm_xor_si128(previous[0], tag);
+  }
+
+  // Hash the last group
+  GCM::CLMUL::Wide sum = GCM::CLMUL::zero();
+#pragma GCC unroll 8
+  for (std::size_t j = 0; j < STITCHED_BLOCKS; ++j) {
+    GCM::CLMUL::accumulate(sum, GCM::CLMUL::multiply_wide(previous[j], h[j]));
   }
-  m_hasher.update(ciphertext);
-  return ciphertext;
+  return GCM::CLMUL::reduce(sum);
+}
+
+void GCM::Encryptor::update(std::span<const std::uint8_t> plaintext,
+                            std::span<std::uint8_t> ciphertext) {
+  assert(plaintext.size() == ciphertext.size());
+  std::size_t i = 0;
+  if (m_aes_128_key) {
+    // Complete the partial block, if any, then stitch whole groups
+    std::size_t head = std::min(plaintext.size(), m_ctr.remaining_keystream());
+    std::size_t groups = (plaintext.size() - head) / (16 * STITCHED_BLOCKS);
+    if (groups > 0) {
+      m_ctr.apply(plaintext.first(head), ciphertext.first(head));
+      m_hasher.update(ciphertext.first(head));
+      i = head;
+      const GCM::AES::Key128 &key = this->stitched_key();
+      m_hasher.update_blocks(
+          16 * STITCHED_BLOCKS * groups,
+          [&](__m128i tag, std::span<const GCM::Polynomial> powers) {
+            return encrypt_stitched(key, m_ctr.y0_block(), m_ctr.next_counter(),
+                                    &plaintext[i], &ciphertext[i], groups, tag,
+                                    powers);
+          });
+      m_ctr.skip_blocks(STITCHED_BLOCKS * groups);
+      i += 16 * STITCHED_BLOCKS * groups;
+    }
+  }
+
+  m_ctr.apply(plaintext.subspan(i), ciphertext.subspan(i));
+  m_hasher.update(ciphertext.subspan(i));
+}
+
+GCM::Polynomial
+GCM::Encryptor::encrypt_chunk(std::span<const std::uint8_t> plaintext,
+                              std::span<std::uint8_t> ciphertext,
+                              std::uint32_t first_block) const {
+  GCM::CounterMode ctr = m_ctr.fork(first_block);
+  GCM::Polynomial tag = GCM::Polynomial::zero();
+  std::size_t i = 0;
+  std::size_t groups = plaintext.size() / (16 * STITCHED_BLOCKS);
+  if (m_stitched_key && groups > 0) {
+    tag = encrypt_stitched(*m_stitched_key, ctr.y0_block(),
+                           ctr.next_counter(), plaintext.data(),
+                           ciphertext.data(), groups, tag.to_m128i(),
+                           m_hasher.key_powers());
+    ctr.skip_blocks(STITCHED_BLOCKS * groups);
+    i = 16 * STITCHED_BLOCKS * groups;
+  }
+  ctr.apply(plaintext.subspan(i), ciphertext.subspan(i));
+  return m_hasher.absorb(tag, ciphertext.subspan(i));
+}
+
+void GCM::Encryptor::update_parallel(std::span<const std::uint8_t> plaintext,
+                                     std::span<std::uint8_t> ciphertext,
+                                     std::size_t threads) {
+  assert(plaintext.size() == ciphertext.size());
+  // Complete the partial block first, so the chunks start on block boundaries
+  std::size_t head = std::min(plaintext.size(), m_ctr.remaining_keystream());
+  this->update(plaintext.first(head), ciphertext.first(head));
+  plaintext = plaintext.subspan(head);
+  ciphertext = ciphertext.subspan(head);
+
+  threads = std::max<std::size_t>(threads, 1);
+  const std::size_t count = plaintext.size() / 16;
+  // Whole groups per chunk, so that only the last chunk has a stitched
+  // remainder
+  std::size_t chunk_blocks = std::max(GCM::GHASH::PARALLEL_MIN_BLOCKS,
+                                      (count + threads - 1) / threads);
+  chunk_blocks = (chunk_blocks + STITCHED_BLOCKS - 1) / STITCHED_BLOCKS *
+                 STITCHED_BLOCKS;
+  const std::size_t chunks = (count + chunk_blocks - 1) / chunk_blocks;
+  if (chunks <= 1) {
+    this->update(plaintext, ciphertext);
+    return;
+  }
+
+  // Botan's block ciphers do not change after set_key, so the threads share
+  // m_cipher. Every chunk has whole groups, so the stitched round keys are
+  // expanded here, before the threads read them.
+  if (m_aes_128_key) {
+    this->stitched_key();
+  }
+  std::vector<GCM::Polynomial> partial_tags(chunks, GCM::Polynomial::zero());
+  Parallel::for_each_index(
+      chunks,
+      [&](std::size_t i) {
+        std::size_t first = i * chunk_blocks;
+        std::size_t blocks = std::min(chunk_blocks, count - first);
+        partial_tags[i] =
+            this->encrypt_chunk(plaintext.subspan(16 * first, 16 * blocks),
+                                ciphertext.subspan(16 * first, 16 * blocks),
+                                static_cast<std::uint32_t>(first));
+      },
+      threads);
+  m_hasher.combine_chunks(partial_tags, chunk_blocks, count);
+  m_ctr.skip_blocks(static_cast<std::uint32_t>(count));
+
+  this->update(plaintext.subspan(16 * count), ciphertext.subspan(16 * count));
 }
 
 std::vector<std::uint8_t> GCM::Encryptor::finalize() {
@@ -107,4 +287,190 @@ TEST_CASE("test counter mode block generator with 8 byte nonce") {
   CHECK(Botan::hex_encode(e.y_block(3)) == "C43A83C4C4BADEC4354CA984DB252F80");
   CHECK(Botan::hex_encode(e.y_block(4)) == "C43A83C4C4BADEC4354CA984DB252F81");
 }
-#endif
\ No newline at end of file
+
+TEST_CASE("test encryption in chunks of any size matches NIST test case 4") {
+  std::vector<std::uint8_t> key =
+      Botan::hex_decode("feffe9928665731c6d6a8f9467308308");
+  std::vector<std::uint8_t> nonce =
+      Botan::hex_decode("cafebabefacedbaddecaf888");
+  std::vector<std::uint8_t> associated_data =
+      Botan::hex_decode("feedfacedeadbeeffeedfacedeadbeefabaddad2");
+  std::vector<std::uint8_t> plaintext = Botan::hex_decode(
+      "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a72"
+      "1c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39");
+  const std::string ciphertext =
+      "42831EC2217774244B7221B784D0D49CE3AA212F2C02A4E035C17E2329ACA12E"
+      "21D514B25466931C7D8F6A5AAC84AA051BA30B396A0AAC973D58E091";
+  const std::string auth_tag = "5BC94FBC3221A5DB94FAE95AE7121A47";
+
+  for (std::size_t chunk : {1, 7, 16, 21, 60}) {
+    auto aes = Botan::BlockCipher::create_or_throw("AES-128");
+    aes->set_key(key);
+    GCM::Encryptor e = GCM::Encryptor(associated_data, std::move(aes), nonce);
+    std::vector<std::uint8_t> buffer = plaintext;
+    for (std::size_t i = 0; i < buffer.size(); i += chunk) {
+      std::span<std::uint8_t> part = std::span(buffer).subspan(
+          i, std::min(chunk, buffer.size() - i));
+      e.update(part, part);
+    }
+    CHECK(Botan::hex_encode(buffer) == ciphertext);
+    CHECK(Botan::hex_encode(e.finalize()) == auth_tag);
+  }
+}
+
+TEST_CASE("test stitched encryption matches two-pass encryption") {
+  std::vector<std::uint8_t> key =
+      Botan::hex_decode("feffe9928665731c6d6a8f9467308308");
+  std::vector<std::uint8_t> associated_data(20, 0xab);
+  std::vector<std::uint8_t> plaintext(16 * 8 * 5 + 21);
+  for (std::size_t i = 0; i < plaintext.size(); ++i) {
+    plaintext[i] = i * 7 + (i >> 8);
+  }
+
+  // 8 byte nonces derive Y0 with GHASH, so the counter wraps around
+  for (const char *nonce : {"cafebabefacedbaddecaf888", "cafebabefacedbad"}) {
+    GCM::Encryptor two_pass(associated_data, key, Botan::hex_decode(nonce),
+                            GCM::Encryptor::Mode::TwoPass);
+    CHECK(two_pass.mode() == GCM::Encryptor::Mode::TwoPass);
+    std::vector<std::uint8_t> expected = two_pass.update(plaintext);
+    std::vector<std::uint8_t> expected_tag = two_pass.finalize();
+
+    // Chunks which start in the middle of blocks and cover whole groups
+    for (std::size_t chunk :
+         {std::size_t{7}, std::size_t{16 * 8}, std::size_t{16 * 8 * 2 + 9},
+          plaintext.size()}) {
+      GCM::Encryptor stitched(associated_data, key, Botan::hex_decode(nonce));
+      if (GCM::AES::aesni() && GCM::Backend::pclmul()) {
+        CHECK(stitched.mode() == GCM::Encryptor::Mode::Stitched);
+      }
+      std::vector<std::uint8_t> buffer = plaintext;
+      for (std::size_t i = 0; i < buffer.size(); i += chunk) {
+        std::span<std::uint8_t> part = std::span(buffer).subspan(
+            i, std::min(chunk, buffer.size() - i));
+        stitched.update(part, part);
+      }
+      CHECK(buffer == expected);
+      CHECK(stitched.finalize() == expected_tag);
+    }
+  }
+}
+
+TEST_CASE("test stitched encryption expands the round keys on first use") {
+  std::vector<std::uint8_t> key =
+      Botan::hex_decode("feffe9928665731c6d6a8f9467308308");
+  std::vector<std::uint8_t> nonce =
+      Botan::hex_decode("cafebabefacedbaddecaf888");
+  GCM::Encryptor e({}, key, nonce);
+  if (e.mode() != GCM::Encryptor::Mode::Stitched) {
+    return;
+  }
+  // A byte short of a whole group
+  e.update(std::vector<std::uint8_t>(16 * 8 - 1));
+  CHECK(!e.m_stitched_key);
+  e.update(std::vector<std::uint8_t>(16 * 8 + 1));
+  CHECK(e.m_stitched_key);
+  CHECK(e.mode() == GCM::Encryptor::Mode::Stitched);
+}
+TEST_CASE("test parallel encryption matches serial encryption") {
+  std::vector<std::uint8_t> key =
+      Botan::hex_decode("feffe9928665731c6d6a8f9467308308");
+  std::vector<std::uint8_t> nonce =
+      Botan::hex_decode("cafebabefacedbaddecaf888");
+  std::vector<std::uint8_t> associated_data(20, 0xab);
+  // Three full chunks on 3 threads, plus a partial chunk with a stitched
+  // remainder and a partial block
+  std::vector<std::uint8_t> plaintext(
+      16 * GCM::GHASH::PARALLEL_MIN_BLOCKS * 3 + 16 * 13 + 9);
+  for (std::size_t i = 0; i < plaintext.size(); ++i) {
+    plaintext[i] = i * 3 + (i >> 10);
+  }
+
+  for (GCM::Encryptor::Mode mode :
+       {GCM::Encryptor::Mode::TwoPass, GCM::Encryptor::Mode::Stitched}) {
+    GCM::Encryptor serial(associated_data, key, nonce, mode);
+    std::vector<std::uint8_t> expected = serial.update(plaintext);
+    std::vector<std::uint8_t> expected_tag = serial.finalize();
+
+    // A partial block before the parallel update
+    GCM::Encryptor parallel(associated_data, key, nonce, mode);
+    std::vector<std::uint8_t> buffer = plaintext;
+    std::span<std::uint8_t> head = std::span(buffer).first(7);
+    std::span<std::uint8_t> rest = std::span(buffer).subspan(7);
+    parallel.update(head, head);
+    parallel.update_parallel(rest, rest, 3);
+    CHECK(buffer == expected);
+    CHECK(parallel.finalize() == expected_tag);
+  }
+}
+#endif
+
+#ifdef BENCH
+#include <botan/aead.h>
+#include <botan/hex.h>
+#include <string>
+
+#include "benchmark.hpp"
+
+/// @brief benchmark the two-pass and stitched Encryptor against Botan's GCM
+static void benchmark_modes(const std::vector<std::uint8_t> &key,
+                            const std::vector<std::uint8_t> &nonce,
+                            const std::vector<std::uint8_t> &associated_data,
+                            const std::vector<std::uint8_t> &plaintext) {
+  std::vector<std::uint8_t> buffer = plaintext;
+  auto run = [&](const char *name, GCM::Encryptor::Mode mode) {
+    Benchmark::throughput(name, buffer.size(), [&]() {
+      GCM::Encryptor e(associated_data, key, nonce, mode);
+      e.update(buffer, buffer);
+      e.finalize();
+    });
+  };
+  run("two-pass", GCM::Encryptor::Mode::TwoPass);
+  if (GCM::AES::aesni() && GCM::Backend::pclmul()) {
+    run("stitched", GCM::Encryptor::Mode::Stitched);
+  }
+
+  auto gcm = Botan::AEAD_Mode::create_or_throw("AES-128/GCM", Botan::ENCRYPTION);
+  gcm->set_key(key);
+  Botan::secure_vector<std::uint8_t> message;
+  Benchmark::throughput("botan", plaintext.size(), [&]() {
+    message.assign(plaintext.begin(), plaintext.end());
+    gcm->set_associated_data(associated_data.data(), associated_data.size());
+    gcm->start(nonce.data(), nonce.size());
+    gcm->finish(message);
+  });
+}
+
+BENCHMARK_CASE("gcm encrypt, NIST test case 4") {
+  benchmark_modes(
+      Botan::hex_decode("feffe9928665731c6d6a8f9467308308"),
+      Botan::hex_decode("cafebabefacedbaddecaf888"),
+      Botan::hex_decode("feedfacedeadbeeffeedfacedeadbeefabaddad2"),
+      Botan::hex_decode(
+          "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a72"
+          "1c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39"));
+}
+
+BENCHMARK_CASE("gcm encrypt, 1 MiB") {
+  benchmark_modes(std::vector<std::uint8_t>(16, 0x42),
+                  std::vector<std::uint8_t>(12, 0x24), {},
+                  std::vector<std::uint8_t>(1 << 20, 0x5a));
+}
+
+BENCHMARK_CASE("gcm encrypt, 64 MiB") {
+  std::vector<std::uint8_t> key(16, 0x42);
+  std::vector<std::uint8_t> nonce(12, 0x24);
+  std::vector<std::uint8_t> buffer(1 << 26, 0x5a);
+  Benchmark::throughput("serial", buffer.size(), [&]() {
+    GCM::Encryptor e({}, key, nonce);
+    e.update(buffer, buffer);
+    e.finalize();
+  });
+  Benchmark::throughput(
+      "parallel, " + std::to_string(Parallel::default_threads()) + " threads",
+      buffer.size(), [&]() {
+        GCM::Encryptor e({}, key, nonce);
+        e.update_parallel(buffer, buffer);
+        e.finalize();
+      });
+}
+#endif
@@ -1,20 +1,61 @@
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstdint>
-#include <deque>
+#include <emmintrin.h>
+#include <span>
 #include <stdexcept>
+#include <tmmintrin.h>
 #include <vector>
 
-#include "bytemanipulation.hpp"
+#include "cpu.hpp"
+#include "gcm/clmul.hpp"
 #include "gcm/ghash.hpp"
 #include "gcm/polynomial.hpp"
 
-GCM::GHASH::GHASH(std::vector<std::uint8_t> associated_data,
-                  std::vector<std::uint8_t> auth_key)
+/// @brief pshufb mask converting between GCM byte order and the register
+/// order of GCM::Polynomial
+static __m128i byte_reverse() {
+  return _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+}
+
+/// @brief add \p count blocks at \p data to \p tag , one table
+/// multiplication per block. A table lookup per byte is cheap enough that
+/// aggregation does not pay off.
+/// @return the new tag
+static __m128i absorb_table(__m128i tag, const std::uint8_t *data,
+                            std::size_t count, const GCM::Table::Key &key) {
+  const __m128i reverse = byte_reverse();
+  for (std::size_t i = 0; i < count; ++i, data += 16) {
+    __m128i block = _mm_shuffle_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data)), reverse);
+    tag = key.multiply(_mm_xor_si128(tag, block));
+  }
+  return tag;
+}
+
+static GCM::Polynomial key_from_bytes(std::span<const std::uint8_t> auth_key) {
+  assert(auth_key.size() == 16 && "The auth key must be exactly 16 bytes");
+  return GCM::Polynomial::from_gcm_bytes(auth_key.first<16>());
+}
+
+GCM::GHASH::GHASH(std::span<const std::uint8_t> associated_data,
+                  std::span<const std::uint8_t> auth_key,
+                  GCM::Backend::Kind backend)
     : m_auth_tag(GCM::Polynomial::zero()),
-      m_auth_key(GCM::Polynomial::from_gcm_bytes(auth_key)),
+      m_auth_key(key_from_bytes(auth_key)),
       m_associated_data_bitlength(associated_data.size() * 8),
-      m_ciphertext_bitlength(0),
-      m_ciphertext_buffer(std::deque<std::uint8_t>(0)), m_finalized(false) {
+      m_ciphertext_bitlength(0), m_buffered(0), m_finalized(false) {
+  if (backend == GCM::Backend::Kind::Table) {
+    m_key_table.emplace(m_auth_key.to_m128i());
+  } else {
+    m_key_powers.push_back(m_auth_key);
+    while (m_key_powers.size() < GCM::GHASH::AGGREGATED_BLOCKS) {
+      m_key_powers.insert(m_key_powers.begin(),
+                          m_key_powers.front() * m_auth_key);
+    }
+  }
+
   // Add associated data to the beginning of the "stream", padded with 0s
   this->update(associated_data);
   this->pad_current_block();
@@ -24,23 +65,108 @@ GCM::GHASH::GHASH(std::vector<std::uint8_t> associated_data,
   this->m_ciphertext_bitlength = 0;
 }
 
-void GCM::GHASH::update(std::vector<std::uint8_t> ciphertext) {
+void GCM::GHASH::update(std::span<const std::uint8_t> ciphertext) {
+  if (m_finalized) {
+    throw std::runtime_error("Cannot update finalized GHASH.");
+  }
+  m_ciphertext_bitlength += ciphertext.size() * 8;
+
+  // Complete the buffered block first
+  if (m_buffered > 0) {
+    std::size_t taken =
+        std::min(GCM::GHASH::BLOCK_SIZE - m_buffered, ciphertext.size());
+    std::copy_n(ciphertext.begin(), taken, m_buffer.begin() + m_buffered);
+    m_buffered += taken;
+    ciphertext = ciphertext.subspan(taken);
+    if (m_buffered < GCM::GHASH::BLOCK_SIZE) {
+      return;
+    }
+    this->absorb_blocks(m_buffer);
+    m_buffered = 0;
+  }
+
+  std::size_t whole = ciphertext.size() / GCM::GHASH::BLOCK_SIZE *
+                      GCM::GHASH::BLOCK_SIZE;
+  this->absorb_blocks(ciphertext.first(whole));
+  std::copy(ciphertext.begin() + whole, ciphertext.end(), m_buffer.begin());
+  m_buffered = ciphertext.size() - whole;
+}
+
+void GCM::GHASH::update_parallel(std::span<const std::uint8_t> ciphertext,
+                                 std::size_t threads) {
   if (m_finalized) {
     throw std::runtime_error("Cannot update finalized GHASH.");
   }
-  m_ciphertext_buffer.insert(m_ciphertext_buffer.end(), ciphertext.begin(),
-                             ciphertext.end());
-  while (m_ciphertext_buffer.size() >= GCM::GHASH::BLOCK_SIZE) {
-    std::vector<std::uint8_t> block(m_ciphertext_buffer.begin(),
-                                    m_ciphertext_buffer.begin() +
-                                        GCM::GHASH::BLOCK_SIZE);
-    m_ciphertext_buffer.erase(m_ciphertext_buffer.begin(),
-                              m_ciphertext_buffer.begin() +
-                                  GCM::GHASH::BLOCK_SIZE);
-    m_auth_tag += GCM::Polynomial::from_gcm_bytes(block);
-    m_auth_tag *= m_auth_key;
-    m_ciphertext_bitlength += block.size() * 8;
+  // Complete the buffered block first, so the chunks start on block
+  // boundaries
+  std::size_t head =
+      m_buffered == 0
+          ? 0
+          : std::min(GCM::GHASH::BLOCK_SIZE - m_buffered, ciphertext.size());
+  this->update(ciphertext.first(head));
+  ciphertext = ciphertext.subspan(head);
+
+  threads = std::max<std::size_t>(threads, 1);
+  const std::size_t count = ciphertext.size() / GCM::GHASH::BLOCK_SIZE;
+  const std::size_t chunk_blocks = std::max(GCM::GHASH::PARALLEL_MIN_BLOCKS,
+                                            (count + threads - 1) / threads);
+  const std::size_t chunks = (count + chunk_blocks - 1) / chunk_blocks;
+  if (chunks <= 1) {
+    this->update(ciphertext);
+    return;
+  }
+
+  std::vector<GCM::Polynomial> partial_tags(chunks, GCM::Polynomial::zero());
+  Parallel::for_each_index(
+      chunks,
+      [&](std::size_t i) {
+        std::size_t first = i * chunk_blocks;
+        std::size_t blocks = std::min(chunk_blocks, count - first);
+        partial_tags[i] = this->absorb(
+            GCM::Polynomial::zero(),
+            ciphertext.subspan(first * GCM::GHASH::BLOCK_SIZE,
+                               blocks * GCM::GHASH::BLOCK_SIZE));
+      },
+      threads);
+
+  this->combine_chunks(partial_tags, chunk_blocks, count);
+
+  this->update(ciphertext.subspan(count * GCM::GHASH::BLOCK_SIZE));
+}
+
+void GCM::GHASH::combine_chunks(std::span<const GCM::Polynomial> partial_tags,
+                                std::size_t chunk_blocks, std::size_t blocks) {
+  if (m_finalized) {
+    throw std::runtime_error("Cannot update finalized GHASH.");
+  }
+  assert(m_buffered == 0 && "Chunks must start on a block boundary");
+  // Only the last chunk can be shorter
+  const GCM::Polynomial chunk_power =
+      m_auth_key.pow(_mm_set_epi64x(0, chunk_blocks));
+  for (std::size_t i = 0; i < partial_tags.size(); ++i) {
+    std::size_t size = std::min(chunk_blocks, blocks - i * chunk_blocks);
+    GCM::Polynomial power = size == chunk_blocks
+                                ? chunk_power
+                                : m_auth_key.pow(_mm_set_epi64x(0, size));
+    m_auth_tag = m_auth_tag * power + partial_tags[i];
+  }
+  m_ciphertext_bitlength += blocks * GCM::GHASH::BLOCK_SIZE * 8;
+}
+
+GCM::Polynomial
+GCM::GHASH::absorb(GCM::Polynomial tag,
+                   std::span<const std::uint8_t> blocks) const {
+  std::size_t count = blocks.size() / GCM::GHASH::BLOCK_SIZE;
+  if (m_key_table) {
+    return absorb_table(tag.to_m128i(), blocks.data(), count, *m_key_table);
   }
+  return GCM::CLMUL::best_kernels().ghash(
+      tag.to_m128i(), blocks.data(), count,
+      reinterpret_cast<const __m128i *>(m_key_powers.data()));
+}
+
+void GCM::GHASH::absorb_blocks(std::span<const std::uint8_t> blocks) {
+  m_auth_tag = this->absorb(m_auth_tag, blocks);
 }
 
 std::vector<std::uint8_t> GCM::GHASH::finalize() {
@@ -48,29 +174,455 @@ std::vector<std::uint8_t> GCM::GHASH::finalize() {
   this->pad_current_block();
 
   // Create the length field
-  std::vector<std::uint8_t> length;
-  ByteManipulation::append_as_bytes<std::uint64_t>(m_associated_data_bitlength,
-                                                   std::endian::big, length);
-  ByteManipulation::append_as_bytes<std::uint64_t>(m_ciphertext_bitlength,
-                                                   std::endian::big, length);
-  this->update(length);
+  std::array<std::uint8_t, GCM::GHASH::BLOCK_SIZE> length;
+  for (std::size_t i = 0; i < 8; ++i) {
+    length[i] = m_associated_data_bitlength >> (56 - 8 * i);
+    length[8 + i] = m_ciphertext_bitlength >> (56 - 8 * i);
+  }
+  this->absorb_blocks(length);
   this->m_finalized = true;
   return m_auth_tag.to_gcm_bytes();
 }
 
 void GCM::GHASH::pad_current_block() {
-  std::uint64_t padding_length =
-      GCM::GHASH::BLOCK_SIZE - m_ciphertext_buffer.size();
-  if (padding_length == GCM::GHASH::BLOCK_SIZE)
+  if (m_buffered == 0) {
     return;
-  this->update(std::vector<std::uint8_t>(padding_length));
-  m_ciphertext_bitlength -= padding_length * 8;
+  }
+  std::fill(m_buffer.begin() + m_buffered, m_buffer.end(), 0);
+  this->absorb_blocks(m_buffer);
+  m_buffered = 0;
 }
 
-std::vector<std::uint8_t> GCM::ghash(std::vector<std::uint8_t> ciphertext,
-                                     std::vector<std::uint8_t> associated_data,
-                                     std::vector<std::uint8_t> key) {
+std::vector<std::uint8_t>
+GCM::ghash(std::span<const std::uint8_t> ciphertext,
+           std::span<const std::uint8_t> associated_data,
+           std::span<const std::uint8_t> key) {
   GCM::GHASH hasher = GCM::GHASH(associated_data, key);
   hasher.update(ciphertext);
   return hasher.finalize();
 }
+
+std::vector<std::uint8_t>
+GCM::ghash_parallel(std::span<const std::uint8_t> ciphertext,
+                    std::span<const std::uint8_t> associated_data,
+                    std::span<const std::uint8_t> key, std::size_t threads) {
+  GCM::GHASH hasher(associated_data, key);
+  hasher.update_parallel(ciphertext, threads);
+  return hasher.finalize();
+}
+
+/// @brief the number of blocks of \p bytes bytes after zero padding
+static std::uint64_t padded_blocks(std::uint64_t bytes) {
+  return (bytes + 15) / 16;
+}
+
+GCM::IncrementalGHASH::IncrementalGHASH(GCM::Polynomial tag,
+                                       GCM::Polynomial auth_key,
+                                       std::uint64_t associated_data_bytes,
+                                       std::uint64_t ciphertext_bytes)
+    : m_tag(tag), m_auth_key(auth_key),
+      m_associated_data_bytes(associated_data_bytes),
+      m_ciphertext_bytes(ciphertext_bytes) {}
+
+std::uint64_t GCM::IncrementalGHASH::associated_data_blocks() const {
+  return padded_blocks(m_associated_data_bytes);
+}
+
+void GCM::IncrementalGHASH::replace_block(std::uint64_t index,
+                                          const GCM::Polynomial &old_block,
+                                          const GCM::Polynomial &new_block) {
+  if (index >= this->block_count() - 1) {
+    throw std::out_of_range("Block index is past the end of the ciphertext");
+  }
+  m_tag += (old_block + new_block) * this->key_power(this->block_count() - index);
+}
+
+void GCM::IncrementalGHASH::append_blocks(
+    std::span<const GCM::Polynomial> blocks) {
+  if (m_ciphertext_bytes % 16 != 0) {
+    throw std::logic_error(
+        "Cannot append blocks to a ciphertext with a partial last block");
+  }
+  if (blocks.empty()) {
+    return;
+  }
+  // Remove the length block: tag + L * H = X * H, where X is the state
+  // before the length block. Then continue Horner's rule over the new blocks
+  // and the new length block:
+  // X * H^(k + 1) + B_1 * H^(k + 1) + ... + B_k * H^2 + L' * H
+  GCM::Polynomial appended = GCM::Polynomial::zero();
+  for (const GCM::Polynomial &block : blocks) {
+    appended = (appended + block) * m_auth_key;
+  }
+  GCM::Polynomial shifted =
+      (m_tag + this->length_block() * m_auth_key) * this->key_power(blocks.size());
+  m_ciphertext_bytes += blocks.size() * 16;
+  m_tag = shifted + (appended + this->length_block()) * m_auth_key;
+}
+
+void GCM::IncrementalGHASH::set_lengths(std::uint64_t associated_data_bytes,
+                                        std::uint64_t ciphertext_bytes) {
+  if (padded_blocks(associated_data_bytes) !=
+          padded_blocks(m_associated_data_bytes) ||
+      padded_blocks(ciphertext_bytes) != padded_blocks(m_ciphertext_bytes)) {
+    throw std::invalid_argument(
+        "The lengths must not change the number of blocks");
+  }
+  GCM::Polynomial old_length = this->length_block();
+  m_associated_data_bytes = associated_data_bytes;
+  m_ciphertext_bytes = ciphertext_bytes;
+  m_tag += (old_length + this->length_block()) * m_auth_key;
+}
+
+GCM::Polynomial GCM::IncrementalGHASH::length_block() const {
+  return GCM::Polynomial(m_associated_data_bytes * 8, m_ciphertext_bytes * 8);
+}
+
+std::uint64_t GCM::IncrementalGHASH::block_count() const {
+  return padded_blocks(m_associated_data_bytes) +
+         padded_blocks(m_ciphertext_bytes) + 1;
+}
+
+GCM::Polynomial
+GCM::IncrementalGHASH::key_power(std::uint64_t exponent) const {
+  return m_auth_key.pow(_mm_set_epi64x(0, static_cast<long long>(exponent)));
+}
+
+namespace {
+/// @brief the state of one message in ghash_multi()
+struct Lane {
+  const GCM::GHASHInput *input;
+  std::size_t associated_data_blocks;
+  /// @brief including the length block
+  std::size_t total_blocks;
+  __m128i key;
+  __m128i tag;
+
+  explicit Lane(const GCM::GHASHInput &message)
+      : input(&message),
+        associated_data_blocks((message.associated_data.size() + 15) / 16),
+        total_blocks(associated_data_blocks +
+                     (message.ciphertext.size() + 15) / 16 + 1),
+        key(key_from_bytes(message.key).to_m128i()),
+        tag(_mm_setzero_si128()) {}
+
+  /// @brief block \p i of the GHASH input, in register order
+  __m128i block(std::size_t i) const {
+    if (i + 1 == total_blocks) {
+      return _mm_set_epi64x(
+          static_cast<long long>(input->associated_data.size() * 8),
+          static_cast<long long>(input->ciphertext.size() * 8));
+    }
+    std::span<const std::uint8_t> data = input->associated_data;
+    if (i >= associated_data_blocks) {
+      data = input->ciphertext;
+      i -= associated_data_blocks;
+    }
+    std::span<const std::uint8_t> bytes = data.subspan(16 * i);
+    __m128i block;
+    if (bytes.size() >= 16) {
+      block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes.data()));
+    } else {
+      std::array<std::uint8_t, 16> padded{};
+      std::copy(bytes.begin(), bytes.end(), padded.begin());
+      block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(padded.data()));
+    }
+    return _mm_shuffle_epi8(block, byte_reverse());
+  }
+};
+} // namespace
+
+/// @brief run the lanes to completion, one multiplication per lane and step
+/// so that the products of different lanes overlap
+template <typename Multiply>
+__attribute__((always_inline)) static inline void
+hash_lanes(std::span<Lane> lanes, std::size_t steps, Multiply multiply) {
+  for (std::size_t step = 0; step < steps; ++step) {
+    for (Lane &lane : lanes) {
+      if (step < lane.total_blocks) {
+        lane.tag = multiply(_mm_xor_si128(lane.tag, lane.block(step)), lane.key);
+      }
+    }
+  }
+}
+
+CPU_TARGET("pclmul") static void hash_lanes_pclmul(std::span<Lane> lanes,
+                                                   std::size_t steps) {
+  hash_lanes(lanes, steps, [](__m128i a, __m128i b) {
+    return GCM::CLMUL::multiply(a, b);
+  });
+}
+
+static void hash_lanes_table(std::span<Lane> lanes, std::size_t steps) {
+  hash_lanes(lanes, steps, GCM::Table::multiply);
+}
+
+std::vector<std::array<std::uint8_t, 16>>
+GCM::ghash_multi(std::span<const GCM::GHASHInput> inputs,
+                 GCM::Backend::Kind backend) {
+  std::vector<Lane> lanes;
+  lanes.reserve(inputs.size());
+  for (const GCM::GHASHInput &input : inputs) {
+    lanes.emplace_back(input);
+  }
+  // Messages of similar length share a group, so that few lanes idle
+  std::sort(lanes.begin(), lanes.end(), [](const Lane &a, const Lane &b) {
+    return a.total_blocks < b.total_blocks;
+  });
+
+  for (std::size_t i = 0; i < lanes.size(); i += GCM::GHASH_MULTI_LANES) {
+    std::span<Lane> group = std::span(lanes).subspan(i).first(
+        std::min(GCM::GHASH_MULTI_LANES, lanes.size() - i));
+    std::size_t steps = group.back().total_blocks;
+    if (backend == GCM::Backend::Kind::Clmul) {
+      hash_lanes_pclmul(group, steps);
+    } else {
+      hash_lanes_table(group, steps);
+    }
+  }
+
+  std::vector<std::array<std::uint8_t, 16>> tags(inputs.size());
+  for (const Lane &lane : lanes) {
+    tags[lane.input - inputs.data()] = GCM::Polynomial(lane.tag).to_gcm_block();
+  }
+  return tags;
+}
+
+#ifdef TEST
+#include "bytemanipulation.hpp"
+#include "doctest.h"
+
+TEST_CASE("test GHASH aggregation matches block-wise Horner") {
+  std::vector<std::uint8_t> key = GCM::Polynomial::random().to_gcm_bytes();
+  std::vector<std::uint8_t> associated_data(37, 0xaa);
+  std::vector<std::uint8_t> ciphertext(16 * 21 + 5);
+  for (std::size_t i = 0; i < ciphertext.size(); ++i) {
+    ciphertext[i] = i * 7;
+  }
+
+  // Reference: one multiplication per zero-padded block
+  auto blocks = [](std::vector<std::uint8_t> data) {
+    data.resize((data.size() + 15) / 16 * 16);
+    return data;
+  };
+  std::vector<std::uint8_t> stream = blocks(associated_data);
+  std::vector<std::uint8_t> padded = blocks(ciphertext);
+  stream.insert(stream.end(), padded.begin(), padded.end());
+  ByteManipulation::append_as_bytes<std::uint64_t>(
+      associated_data.size() * 8, std::endian::big, stream);
+  ByteManipulation::append_as_bytes<std::uint64_t>(ciphertext.size() * 8,
+                                                   std::endian::big, stream);
+  GCM::Polynomial h = GCM::Polynomial::from_gcm_bytes(key);
+  GCM::Polynomial expected = GCM::Polynomial::zero();
+  for (std::size_t i = 0; i < stream.size(); i += 16) {
+    expected += GCM::Polynomial::from_gcm_bytes(
+        std::vector<std::uint8_t>(stream.begin() + i, stream.begin() + i + 16));
+    expected *= h;
+  }
+
+  // Uneven updates cover partial groups and buffered partial blocks
+  for (GCM::Backend::Kind backend :
+       {GCM::Backend::Kind::Clmul, GCM::Backend::Kind::Table}) {
+    if (backend == GCM::Backend::Kind::Clmul && !GCM::Backend::pclmul()) {
+      continue;
+    }
+    GCM::GHASH hasher(associated_data, key, backend);
+    for (std::size_t offset = 0, size = 1; offset < ciphertext.size();
+         offset += size, size = size * 2 + 3) {
+      size = std::min(size, ciphertext.size() - offset);
+      hasher.update(std::span(ciphertext).subspan(offset, size));
+    }
+    CHECK(hasher.finalize() == expected.to_gcm_bytes());
+  }
+  CHECK(GCM::ghash(ciphertext, associated_data, key) ==
+        expected.to_gcm_bytes());
+}
+
+TEST_CASE("test parallel GHASH matches serial GHASH") {
+  std::vector<std::uint8_t> key = GCM::Polynomial::random().to_gcm_bytes();
+  std::vector<std::uint8_t> associated_data(21, 0x17);
+  // Three full chunks on 3 threads, plus a partial chunk and a partial block
+  std::vector<std::uint8_t> ciphertext(
+      16 * GCM::GHASH::PARALLEL_MIN_BLOCKS * 3 + 16 * 5 + 9);
+  for (std::size_t i = 0; i < ciphertext.size(); ++i) {
+    ciphertext[i] = i * 13 + (i >> 8);
+  }
+  const std::vector<std::uint8_t> expected =
+      GCM::ghash(ciphertext, associated_data, key);
+  CHECK(GCM::ghash_parallel(ciphertext, associated_data, key, 3) == expected);
+
+  for (GCM::Backend::Kind backend :
+       {GCM::Backend::Kind::Clmul, GCM::Backend::Kind::Table}) {
+    if (backend == GCM::Backend::Kind::Clmul && !GCM::Backend::pclmul()) {
+      continue;
+    }
+    // A buffered partial block before the parallel update
+    GCM::GHASH hasher(associated_data, key, backend);
+    hasher.update(std::span(ciphertext).first(7));
+    hasher.update_parallel(std::span(ciphertext).subspan(7), 4);
+    CHECK(hasher.finalize() == expected);
+  }
+}
+
+TEST_CASE("test incremental GHASH matches rehashing") {
+  std::vector<std::uint8_t> key = GCM::Polynomial::random().to_gcm_bytes();
+  GCM::Polynomial h = GCM::Polynomial::from_gcm_bytes(key);
+  std::vector<std::uint8_t> associated_data(20, 0x42);
+  std::vector<std::uint8_t> ciphertext(16 * 9);
+  for (std::size_t i = 0; i < ciphertext.size(); ++i) {
+    ciphertext[i] = i * 5;
+  }
+  auto tag = [&]() {
+    return GCM::Polynomial::from_gcm_bytes(
+        GCM::ghash(ciphertext, associated_data, key));
+  };
+  auto block = [&](std::size_t i) {
+    return GCM::Polynomial::from_gcm_bytes(
+        std::span(ciphertext).subspan(16 * i).first<16>());
+  };
+  GCM::IncrementalGHASH incremental(tag(), h, associated_data.size(),
+                                    ciphertext.size());
+  CHECK(incremental.associated_data_blocks() == 2);
+
+  // Edit a ciphertext block
+  GCM::Polynomial old_block = block(4);
+  ciphertext[16 * 4 + 3] ^= 0x80;
+  incremental.replace_block(incremental.associated_data_blocks() + 4,
+                            old_block, block(4));
+  CHECK(incremental.tag() == tag());
+
+  // Edit an associated data block
+  associated_data[17] = 0x99;
+  incremental.replace_block(
+      1, GCM::Polynomial::from_gcm_bytes({0x42, 0x42, 0x42, 0x42, 0, 0, 0, 0,
+                                          0, 0, 0, 0, 0, 0, 0, 0}),
+      GCM::Polynomial::from_gcm_bytes({0x42, 0x99, 0x42, 0x42, 0, 0, 0, 0, 0,
+                                       0, 0, 0, 0, 0, 0, 0}));
+  CHECK(incremental.tag() == tag());
+  CHECK_THROWS_AS(incremental.replace_block(11, old_block, old_block),
+                  std::out_of_range);
+
+  // Append blocks
+  std::vector<GCM::Polynomial> appended = {GCM::Polynomial::random(),
+                                           GCM::Polynomial::random()};
+  for (const GCM::Polynomial &polynomial : appended) {
+    std::array<std::uint8_t, 16> bytes = polynomial.to_gcm_block();
+    ciphertext.insert(ciphertext.end(), bytes.begin(), bytes.end());
+  }
+  incremental.append_blocks(appended);
+  CHECK(incremental.tag() == tag());
+
+  // Move the end of the ciphertext into its last block, which must be zero
+  // padded
+  std::fill(ciphertext.end() - 6, ciphertext.end(), 0);
+  incremental.replace_block(incremental.associated_data_blocks() + 10,
+                            appended[1], block(10));
+  incremental.set_lengths(associated_data.size(), ciphertext.size() - 6);
+  ciphertext.resize(ciphertext.size() - 6);
+  CHECK(incremental.tag() == tag());
+  CHECK_THROWS_AS(incremental.append_blocks(appended), std::logic_error);
+  CHECK_THROWS_AS(incremental.set_lengths(associated_data.size(), 0),
+                  std::invalid_argument);
+}
+TEST_CASE("test multi-buffer GHASH matches GHASH") {
+  // More messages than lanes, with empty, partial and differing lengths
+  std::vector<std::vector<std::uint8_t>> keys, ciphertexts, associated_data;
+  for (std::size_t i = 0; i < 2 * GCM::GHASH_MULTI_LANES + 3; ++i) {
+    keys.push_back(GCM::Polynomial::random().to_gcm_bytes());
+    ciphertexts.emplace_back((i * 37) % 101, static_cast<std::uint8_t>(i));
+    associated_data.emplace_back((i * 11) % 23, static_cast<std::uint8_t>(~i));
+  }
+  std::vector<GCM::GHASHInput> inputs;
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    inputs.push_back({ciphertexts[i], associated_data[i], keys[i]});
+  }
+
+  for (GCM::Backend::Kind backend :
+       {GCM::Backend::Kind::Clmul, GCM::Backend::Kind::Table}) {
+    if (backend == GCM::Backend::Kind::Clmul && !GCM::Backend::pclmul()) {
+      continue;
+    }
+    std::vector<std::array<std::uint8_t, 16>> tags =
+        GCM::ghash_multi(inputs, backend);
+    REQUIRE(tags.size() == inputs.size());
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+      std::vector<std::uint8_t> expected =
+          GCM::ghash(ciphertexts[i], associated_data[i], keys[i]);
+      CHECK(std::equal(tags[i].begin(), tags[i].end(), expected.begin()));
+    }
+  }
+  CHECK(GCM::ghash_multi({}).empty());
+}
+#endif
+
+#ifdef BENCH
+#include <string>
+
+#include "benchmark.hpp"
+
+BENCHMARK_CASE("ghash, 64 KiB") {
+  std::vector<std::uint8_t> key = GCM::Polynomial::random().to_gcm_bytes();
+  std::vector<std::uint8_t> ciphertext(1 << 16, 0x5a);
+  auto run = [&](const char *name, GCM::Backend::Kind backend) {
+    Benchmark::throughput(name, ciphertext.size(), [&]() {
+      GCM::GHASH hasher({}, key, backend);
+      hasher.update(ciphertext);
+      hasher.finalize();
+    });
+  };
+  if (GCM::Backend::pclmul()) {
+    run("clmul", GCM::Backend::Kind::Clmul);
+  }
+  run("table", GCM::Backend::Kind::Table);
+}
+
+BENCHMARK_CASE("ghash, replace one block of 1 MiB") {
+  std::vector<std::uint8_t> key = GCM::Polynomial::random().to_gcm_bytes();
+  std::vector<std::uint8_t> ciphertext(1 << 20, 0x5a);
+  GCM::Polynomial h = GCM::Polynomial::from_gcm_bytes(key);
+  GCM::IncrementalGHASH incremental(
+      GCM::Polynomial::from_gcm_bytes(GCM::ghash(ciphertext, {}, key)), h, 0,
+      ciphertext.size());
+  GCM::Polynomial old_block = GCM::Polynomial::random();
+  GCM::Polynomial new_block = GCM::Polynomial::random();
+  // Reported as the message size per tag, i.e. the effective throughput
+  Benchmark::throughput("rehash", ciphertext.size(),
+                        [&]() { GCM::ghash(ciphertext, {}, key); });
+  Benchmark::throughput("replace_block", ciphertext.size(), [&]() {
+    incremental.replace_block(17, old_block, new_block);
+    std::swap(old_block, new_block);
+  });
+}
+
+BENCHMARK_CASE("ghash, 64 MiB") {
+  std::vector<std::uint8_t> key = GCM::Polynomial::random().to_gcm_bytes();
+  std::vector<std::uint8_t> ciphertext(1 << 26, 0x5a);
+  Benchmark::throughput("serial", ciphertext.size(), [&]() {
+    GCM::ghash(ciphertext, {}, key);
+  });
+  Benchmark::throughput(
+      "parallel, " + std::to_string(Parallel::default_threads()) + " threads",
+      ciphertext.size(), [&]() { GCM::ghash_parallel(ciphertext, {}, key); });
+}
+
+BENCHMARK_CASE("ghash, 4096 messages of 64 bytes") {
+  constexpr std::size_t MESSAGES = 4096;
+  std::vector<std::vector<std::uint8_t>> keys;
+  for (std::size_t i = 0; i < MESSAGES; ++i) {
+    keys.push_back(GCM::Polynomial::random().to_gcm_bytes());
+  }
+  std::vector<std::uint8_t> ciphertext(64, 0x5a);
+  std::vector<std::uint8_t> associated_data(16, 0xa5);
+  std::vector<GCM::GHASHInput> inputs;
+  for (const std::vector<std::uint8_t> &key : keys) {
+    inputs.push_back({ciphertext, associated_data, key});
+  }
+  Benchmark::throughput("serial", MESSAGES * ciphertext.size(), [&]() {
+    for (const std::vector<std::uint8_t> &key : keys) {
+      GCM::ghash(ciphertext, associated_data, key);
+    }
+  });
+  Benchmark::throughput("multi-buffer", MESSAGES * ciphertext.size(),
+                        [&]() { GCM::ghash_multi(inputs); });
+}
+#endif
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <array>
 #include <bitset>
 #include <cassert>
 #include <csignal>
@@ -6,13 +7,16 @@
 #include <cstdlib>
 #include <emmintrin.h>
 #include <iterator>
+#include <memory>
+#include <mutex>
 #include <ranges>
 #include <smmintrin.h>
 #include <wmmintrin.h>
 
+#include "cpu.hpp"
+#include "gcm/backend.hpp"
 #include "gcm/polynomial.hpp"
-#include "sse.h"
-#include <random>
+#include "random.hpp"
 
 #include <iomanip>
 #include <iostream>
@@ -21,43 +25,46 @@ GCM::Polynomial
 GCM::Polynomial::from_gcm_bytes(const std::vector<std::uint8_t> &gcm_bytes) {
   assert((gcm_bytes.size() == 16) &&
          "Must supply exactly 16 bytes to construct a polynomial!");
-  __m128i x = _mm_setr_epi8(
-      gcm_bytes.at(15), gcm_bytes.at(14), gcm_bytes.at(13), gcm_bytes.at(12),
-      gcm_bytes.at(11), gcm_bytes.at(10), gcm_bytes.at(9), gcm_bytes.at(8),
-      gcm_bytes.at(7), gcm_bytes.at(6), gcm_bytes.at(5), gcm_bytes.at(4),
-      gcm_bytes.at(3), gcm_bytes.at(2), gcm_bytes.at(1), gcm_bytes.at(0));
-  // std::raise(SIGTRAP);
-  return GCM::Polynomial(x);
-}
-
-std::vector<std::uint8_t> GCM::Polynomial::to_gcm_bytes() {
-  alignas(16) std::uint8_t bytes[16];
-  _mm_store_si128((__m128i *)bytes, this->m_polynomial);
-  std::reverse_iterator<const std::uint8_t *> first(&bytes[16]);
-  std::reverse_iterator<const std::uint8_t *> last(&bytes[0]);
-  auto gcm_bytes = std::vector<std::uint8_t>(first, last);
-  return gcm_bytes;
+  return GCM::Polynomial::from_gcm_bytes(
+      std::span<const std::uint8_t, 16>(gcm_bytes.data(), 16));
 }
 
 GCM::Polynomial
-GCM::Polynomial::from_exponents(const std::vector<std::uint8_t> &exponents) {
-  __m128i x = _mm_setzero_si128();
+GCM::Polynomial::from_exponents(std::span<const std::uint8_t> exponents) {
+  // Exponent e is bit 127 - e, i.e. exponents 0..63 live in the high half
+  std::uint64_t halves[2] = {0, 0};
   for (const std::uint8_t &exponent : exponents) {
     assert((exponent < 128) && "Exponent must be less than 128");
-    x = _mm_or_si128(x, SSE::from_index(127 - exponent));
+    halves[exponent / 64] |= (1llu << 63) >> (exponent % 64);
   }
-  // std::raise(SIGTRAP);
-  return GCM::Polynomial(x);
+  return GCM::Polynomial(halves[0], halves[1]);
 }
 
-std::vector<std::uint8_t> GCM::Polynomial::to_exponents() const {
-  auto exponents = std::vector<std::uint8_t>();
-  for (const std::size_t &exponent : std::views::iota(0u, 128u)) {
-    if (SSE::test(this->m_polynomial, 127 - exponent)) {
-      exponents.push_back(exponent);
+std::size_t
+GCM::Polynomial::to_exponents(std::span<std::uint8_t, 128> out) const {
+  const std::uint64_t halves[2] = {
+      static_cast<std::uint64_t>(_mm_extract_epi64(this->m_polynomial, 1)),
+      static_cast<std::uint64_t>(_mm_cvtsi128_si64(this->m_polynomial))};
+  // Bit b of a half is exponent 63 - b (plus 64 in the low half), so the
+  // lowest set bit is the largest exponent. Clearing it with bits & (bits - 1)
+  // is cheaper than clearing the highest bit, so fill each half from its end.
+  std::size_t count = 0;
+  for (std::size_t half = 0; half < 2; ++half) {
+    std::uint64_t bits = halves[half];
+    count += std::popcount(bits);
+    for (std::size_t i = count; bits != 0; bits &= bits - 1) {
+      out[--i] =
+          static_cast<std::uint8_t>(half * 64 + 63 - std::countr_zero(bits));
     }
   }
-  return exponents;
+  return count;
+}
+
+std::vector<std::uint8_t> GCM::Polynomial::to_exponents() const {
+  std::array<std::uint8_t, 128> exponents;
+  std::size_t count = this->to_exponents(exponents);
+  return std::vector<std::uint8_t>(exponents.begin(),
+                                   exponents.begin() + count);
 }
 
 GCM::Polynomial &GCM::Polynomial::operator+=(const Polynomial &rhs) {
@@ -65,55 +72,37 @@ GCM::Polynomial &GCM::Polynomial::operator+=(const Polynomial &rhs) {
   return *this;
 }
 
-GCM::Polynomial &GCM::Polynomial::operator*=(const Polynomial &rhs) {
-  __m128i a = this->m_polynomial;
-  __m128i b = rhs.m_polynomial;
-
-  // Algorithm from
-  // https://www.intel.com/content/dam/develop/external/us/en/documents/clmul-wp-rev-2-02-2014-04-20.pdf
-
-  // It uses 4 clmul operations to compute the 256-bit product (by textbook long
-  // multiplication) and then reduces the resulting polynomial using shifting
-  // and XOR tricks.
-  __m128i tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8, tmp9;
-  tmp3 = _mm_clmulepi64_si128(a, b, 0x00);
-  tmp4 = _mm_clmulepi64_si128(a, b, 0x10);
-  tmp5 = _mm_clmulepi64_si128(a, b, 0x01);
-  tmp6 = _mm_clmulepi64_si128(a, b, 0x11);
-  tmp4 = _mm_xor_si128(tmp4, tmp5);
-  tmp5 = _mm_slli_si128(tmp4, 8);
-  tmp4 = _mm_srli_si128(tmp4, 8);
-  tmp3 = _mm_xor_si128(tmp3, tmp5);
-  tmp6 = _mm_xor_si128(tmp6, tmp4);
-  tmp7 = _mm_srli_epi32(tmp3, 31);
-  tmp8 = _mm_srli_epi32(tmp6, 31);
-  tmp3 = _mm_slli_epi32(tmp3, 1);
-  tmp6 = _mm_slli_epi32(tmp6, 1);
-  tmp9 = _mm_srli_si128(tmp7, 12);
-  tmp8 = _mm_slli_si128(tmp8, 4);
-  tmp7 = _mm_slli_si128(tmp7, 4);
-  tmp3 = _mm_or_si128(tmp3, tmp7);
-  tmp6 = _mm_or_si128(tmp6, tmp8);
-  tmp6 = _mm_or_si128(tmp6, tmp9);
-  tmp7 = _mm_slli_epi32(tmp3, 31);
-  tmp8 = _mm_slli_epi32(tmp3, 30);
-  tmp9 = _mm_slli_epi32(tmp3, 25);
-  tmp7 = _mm_xor_si128(tmp7, tmp8);
-  tmp7 = _mm_xor_si128(tmp7, tmp9);
-  tmp8 = _mm_srli_si128(tmp7, 4);
-  tmp7 = _mm_slli_si128(tmp7, 12);
-  tmp3 = _mm_xor_si128(tmp3, tmp7);
-  tmp2 = _mm_srli_epi32(tmp3, 1);
-  tmp4 = _mm_srli_epi32(tmp3, 2);
-  tmp5 = _mm_srli_epi32(tmp3, 7);
-  tmp2 = _mm_xor_si128(tmp2, tmp4);
-  tmp2 = _mm_xor_si128(tmp2, tmp5);
-  tmp2 = _mm_xor_si128(tmp2, tmp8);
-  tmp3 = _mm_xor_si128(tmp3, tmp2);
-  tmp6 = _mm_xor_si128(tmp6, tmp3);
-
-  this->m_polynomial = tmp6;
-  return *this;
+// The batch functions hand the spans to the kernels as arrays of registers
+static_assert(sizeof(GCM::Polynomial) == sizeof(__m128i));
+
+void GCM::Polynomial::multiply(std::span<const Polynomial> a,
+                               std::span<const Polynomial> b,
+                               std::span<Polynomial> out) {
+  assert(a.size() == b.size() && a.size() == out.size() &&
+         "Operands must have the same size");
+  CLMUL::best_kernels().multiply(reinterpret_cast<const __m128i *>(a.data()),
+                                 reinterpret_cast<const __m128i *>(b.data()),
+                                 reinterpret_cast<__m128i *>(out.data()),
+                                 a.size());
+}
+
+void GCM::Polynomial::multiply(std::span<const Polynomial> a,
+                               const Polynomial &scalar,
+                               std::span<Polynomial> out) {
+  assert(a.size() == out.size() && "Operands must have the same size");
+  CLMUL::best_kernels().scale(reinterpret_cast<const __m128i *>(a.data()),
+                              scalar.m_polynomial,
+                              reinterpret_cast<__m128i *>(out.data()),
+                              a.size());
+}
+
+GCM::Polynomial GCM::Polynomial::dot(std::span<const Polynomial> a,
+                                     std::span<const Polynomial> b) {
+  assert(a.size() == b.size() && "Operands must have the same size");
+  return Polynomial(
+      CLMUL::best_kernels().dot(reinterpret_cast<const __m128i *>(a.data()),
+                                reinterpret_cast<const __m128i *>(b.data()),
+                                a.size()));
 }
 
 GCM::Polynomial &GCM::Polynomial::operator/=(const Polynomial &rhs) {
@@ -121,29 +110,238 @@ GCM::Polynomial &GCM::Polynomial::operator/=(const Polynomial &rhs) {
   return *this;
 }
 
-GCM::Polynomial GCM::Polynomial::pow(__m128i exponent) const {
-  __m128i lowest_bit = _mm_setr_epi32(0x1, 0, 0, 0);
-  Polynomial out = Polynomial::one();
-  Polynomial base = *this;
+/// x^(2^k) is GF(2)-linear in x, so it is determined by the images of the 128
+/// basis bits. Grouping those by nibble turns the matrix-vector product into
+/// 32 lookups.
+using FrobeniusTable = std::array<std::array<GCM::Field::Limbs, 16>, 32>;
+
+/// @brief build the Frobenius table for \p k squarings. The Frobenius map is
+/// a field automorphism, so the image of the basis element x^j is y^j with
+/// y = x^(2^k). This keeps constant evaluation down to k squarings and 127
+/// multiplications.
+static constexpr FrobeniusTable make_frobenius_table(std::size_t k) {
+  GCM::Field y = GCM::Field(GCM::Field::Limbs{0, 1llu << 62});
+  for (std::size_t i = 0; i < k; ++i) {
+    y = y.square();
+  }
+  FrobeniusTable table{};
+  GCM::Field image = GCM::Field::one();
+  for (std::size_t exponent = 0; exponent < 128; ++exponent) {
+    // The factor of x^j is bit 127 - j
+    std::size_t bit = 127 - exponent;
+    for (std::size_t value = 0; value < 16; ++value) {
+      if (value >> (bit % 4) & 1) {
+        table[bit / 4][value][0] ^= image.limbs()[0];
+        table[bit / 4][value][1] ^= image.limbs()[1];
+      }
+    }
+    image *= y;
+  }
+  return table;
+}
+
+/// The squaring runs of the Itoh-Tsujii chain in modular_inverse(), computed
+/// at compile time
+alignas(16) static constexpr FrobeniusTable FROBENIUS_15 =
+    make_frobenius_table(15);
+alignas(16) static constexpr FrobeniusTable FROBENIUS_31 =
+    make_frobenius_table(31);
+alignas(16) static constexpr FrobeniusTable FROBENIUS_63 =
+    make_frobenius_table(63);
+
+static const FrobeniusTable &frobenius_table(std::size_t k) {
+  switch (k) {
+  case 15:
+    return FROBENIUS_15;
+  case 31:
+    return FROBENIUS_31;
+  case 63:
+    return FROBENIUS_63;
+  }
+  static std::array<std::once_flag, 128> built;
+  static std::array<std::unique_ptr<FrobeniusTable>, 128> tables;
+  std::call_once(built[k], [k]() {
+    tables[k] = std::make_unique<FrobeniusTable>(make_frobenius_table(k));
+  });
+  return *tables[k];
+}
+
+/// @brief the Frobenius map of \p x for more than FROBENIUS_TABLE_THRESHOLD
+/// squarings
+static __m128i frobenius_lookup(__m128i x, std::size_t k) {
+  const FrobeniusTable &table = frobenius_table(k);
+  const std::uint64_t halves[2] = {
+      static_cast<std::uint64_t>(_mm_cvtsi128_si64(x)),
+      static_cast<std::uint64_t>(_mm_extract_epi64(x, 1))};
+  __m128i out = _mm_setzero_si128();
+  for (std::size_t nibble = 0; nibble < 32; ++nibble) {
+    std::size_t value = halves[nibble / 16] >> (nibble % 16 * 4) & 0xf;
+    out = _mm_xor_si128(out, _mm_loadu_si128(reinterpret_cast<const __m128i *>(
+                                 table[nibble][value].data())));
+  }
+  return out;
+}
+
+// Each loop below has a pclmul and a portable entry point, see
+// GCM::Backend::ClmulOps.
+
+/// @brief GCM::Polynomial::frobenius with \p k already reduced modulo 128
+template <typename Ops>
+__attribute__((always_inline)) static inline __m128i
+frobenius_with(__m128i x, std::size_t k) {
+  if (k > GCM::FROBENIUS_TABLE_THRESHOLD) {
+    return frobenius_lookup(x, k);
+  }
+  for (std::size_t i = 0; i < k; ++i) {
+    x = Ops::square(x);
+  }
+  return x;
+}
+
+CPU_TARGET("pclmul") static __m128i frobenius_pclmul(__m128i x, std::size_t k) {
+  return frobenius_with<GCM::Backend::ClmulOps>(x, k);
+}
+
+static __m128i frobenius_portable(__m128i x, std::size_t k) {
+  return frobenius_with<GCM::Backend::TableOps>(x, k);
+}
+
+GCM::Polynomial GCM::Polynomial::frobenius(std::size_t k) const {
+  // x^(2^128) = x for every element of the field
+  k %= 128;
+  return Polynomial(Backend::pclmul() ? frobenius_pclmul(m_polynomial, k)
+                                      : frobenius_portable(m_polynomial, k));
+}
+
+/// @brief square-and-multiply, starting at the lowest bit of \p exponent
+template <typename Ops>
+__attribute__((always_inline)) static inline __m128i
+pow_with(__m128i base, __m128i exponent) {
+  const __m128i lowest_bit = _mm_setr_epi32(0x1, 0, 0, 0);
+  __m128i out = GCM::Polynomial::one().to_m128i();
   while (!_mm_test_all_zeros(exponent, exponent)) {
     if (!_mm_testz_si128(exponent, lowest_bit)) {
-      out *= base;
+      out = Ops::multiply(out, base);
     }
     __m128i shifted = _mm_srli_epi32(exponent, 1);
     __m128i carry = _mm_slli_epi32(exponent, 31);
     carry = _mm_srli_si128(carry, 4);
     exponent = _mm_or_si128(shifted, carry);
-    base *= base;
+    base = Ops::square(base);
   }
   return out;
 }
 
+CPU_TARGET("pclmul") static __m128i pow_pclmul(__m128i base, __m128i exponent) {
+  return pow_with<GCM::Backend::ClmulOps>(base, exponent);
+}
+
+static __m128i pow_portable(__m128i base, __m128i exponent) {
+  return pow_with<GCM::Backend::TableOps>(base, exponent);
+}
+
+GCM::Polynomial GCM::Polynomial::pow(__m128i exponent) const {
+  return Polynomial(Backend::pclmul() ? pow_pclmul(m_polynomial, exponent)
+                                      : pow_portable(m_polynomial, exponent));
+}
+
+/// @brief the Itoh-Tsujii chain. beta(k) = x^(2^k - 1) satisfies
+/// beta(i + j) = beta(i)^(2^j) * beta(j), so beta(127) follows from the chain
+/// 1, 2, 3, 6, 7, 14, ..., 126, 127 and x^-1 = x^(2^128 - 2) = beta(127)^2.
+/// The long squaring runs go through the Frobenius tables.
+template <typename Ops>
+__attribute__((always_inline)) static inline __m128i inverse_with(__m128i x) {
+  __m128i beta = x;
+  std::size_t k = 1;
+  while (k < 127) {
+    // Double k, then add 1 unless that overshoots 127 (only at the end)
+    beta = Ops::multiply(frobenius_with<Ops>(beta, k), beta);
+    k *= 2;
+    if (k < 127) {
+      beta = Ops::multiply(Ops::square(beta), x);
+      k += 1;
+    }
+  }
+  return Ops::square(beta);
+}
+
+/// @brief Montgomery's trick, see GCM::Polynomial::modular_inverse(span, span)
+template <typename Ops>
+__attribute__((always_inline)) static inline void
+inverse_batch_with(std::span<const GCM::Polynomial> a,
+                   std::span<GCM::Polynomial> out) {
+  const GCM::Polynomial zero = GCM::Polynomial::zero();
+  // prefix[i] is the product of all nonzero a[0..=i]
+  auto prefix = std::vector<GCM::Polynomial>();
+  prefix.reserve(a.size());
+  __m128i product = GCM::Polynomial::one().to_m128i();
+  for (const GCM::Polynomial &element : a) {
+    if (element != zero) {
+      product = Ops::multiply(product, element.to_m128i());
+    }
+    prefix.push_back(product);
+  }
+
+  // Walk backwards, peeling one factor off the inverted product at a time
+  __m128i inverse = inverse_with<Ops>(product);
+  for (std::size_t i = a.size(); i-- > 0;) {
+    if (a[i] == zero) {
+      out[i] = zero;
+      continue;
+    }
+    __m128i element = a[i].to_m128i();
+    out[i] = i > 0 ? Ops::multiply(inverse, prefix[i - 1].to_m128i()) : inverse;
+    inverse = Ops::multiply(inverse, element);
+  }
+}
+
+CPU_TARGET("pclmul") static __m128i inverse_pclmul(__m128i x) {
+  return inverse_with<GCM::Backend::ClmulOps>(x);
+}
+
+static __m128i inverse_portable(__m128i x) {
+  return inverse_with<GCM::Backend::TableOps>(x);
+}
+
+CPU_TARGET("pclmul") static void
+inverse_batch_pclmul(std::span<const GCM::Polynomial> a,
+                     std::span<GCM::Polynomial> out) {
+  inverse_batch_with<GCM::Backend::ClmulOps>(a, out);
+}
+
+static void inverse_batch_portable(std::span<const GCM::Polynomial> a,
+                                   std::span<GCM::Polynomial> out) {
+  inverse_batch_with<GCM::Backend::TableOps>(a, out);
+}
+
+GCM::Polynomial GCM::Polynomial::modular_inverse() const {
+  return Polynomial(Backend::pclmul() ? inverse_pclmul(m_polynomial)
+                                      : inverse_portable(m_polynomial));
+}
+
+void GCM::Polynomial::modular_inverse(std::span<const Polynomial> a,
+                                      std::span<Polynomial> out) {
+  assert(a.size() == out.size() && "Operands must have the same size");
+  if (a.empty()) {
+    return;
+  }
+  if (Backend::pclmul()) {
+    inverse_batch_pclmul(a, out);
+  } else {
+    inverse_batch_portable(a, out);
+  }
+}
+
 GCM::Polynomial GCM::Polynomial::random() {
-  static std::random_device rd;
-  static std::mt19937_64 gen(rd());
-  static std::uniform_int_distribution<std::uint64_t> dis;
-  __m128i x = _mm_setr_epi64(_mm_set_pi64x(dis(gen)), _mm_set_pi64x(dis(gen)));
-  return GCM::Polynomial(x);
+  Random::Xoshiro256 &generator = Random::generator();
+  std::uint64_t high = generator();
+  return GCM::Polynomial(high, generator());
+}
+
+void GCM::Polynomial::random(std::span<Polynomial> out) {
+  static_assert(sizeof(Polynomial) == 2 * sizeof(std::uint64_t));
+  Random::generator().fill(
+      std::span(reinterpret_cast<std::uint64_t *>(out.data()), 2 * out.size()));
 }
 
 #ifdef TEST
@@ -170,6 +368,24 @@ TEST_CASE("polynomial factor conversions") {
   CHECK(expected.to_exponents() == exponents);
 }
 
+TEST_CASE("polynomial array conversions round trip") {
+  for (int i = 0; i < 16; ++i) {
+    GCM::Polynomial a = GCM::Polynomial::random();
+    std::array<std::uint8_t, 16> block = a.to_gcm_block();
+    CHECK(std::vector<std::uint8_t>(block.begin(), block.end()) ==
+          a.to_gcm_bytes());
+    CHECK(GCM::Polynomial::from_gcm_bytes(block) == a);
+
+    std::array<std::uint8_t, 128> exponents;
+    std::size_t count = a.to_exponents(exponents);
+    CHECK(std::is_sorted(exponents.begin(), exponents.begin() + count));
+    CHECK(GCM::Polynomial::from_exponents(
+              std::span(exponents).first(count)) == a);
+  }
+  std::array<std::uint8_t, 128> exponents;
+  CHECK(GCM::Polynomial::zero().to_exponents(exponents) == 0);
+}
+
 TEST_CASE("polynomial addition") {
   GCM::Polynomial a = GCM::Polynomial::from_exponents(
       {0, 1, 2, 3, 10, 11, 12, 13, 125, 126, 127});
@@ -209,6 +425,74 @@ TEST_CASE("polynomial inverse") {
   CHECK(a * a_inv == GCM::Polynomial::one());
 }
 
+TEST_CASE("polynomial inverse matches exponentiation") {
+  const __m128i order_minus_two =
+      _mm_setr_epi32(0xfffffffe, 0xffffffff, 0xffffffff, 0xffffffff);
+  for (int i = 0; i < 16; ++i) {
+    GCM::Polynomial a = GCM::Polynomial::random();
+    CHECK(a.modular_inverse() == a.pow(order_minus_two));
+  }
+  CHECK(GCM::Polynomial::zero().modular_inverse() == GCM::Polynomial::zero());
+  CHECK(GCM::Polynomial::one().modular_inverse() == GCM::Polynomial::one());
+}
+
+TEST_CASE("polynomial square and frobenius") {
+  for (int i = 0; i < 8; ++i) {
+    GCM::Polynomial a = GCM::Polynomial::random();
+    CHECK(a.square() == a * a);
+
+    GCM::Polynomial squared = a;
+    for (std::size_t k = 0; k < 130; ++k) {
+      CHECK(a.frobenius(k) == squared);
+      squared = squared.square();
+    }
+  }
+}
+
+TEST_CASE("polynomial compile-time frobenius tables match runtime") {
+  // Called at runtime, make_frobenius_table() uses the intrinsics
+  CHECK(FROBENIUS_15 == make_frobenius_table(15));
+  CHECK(FROBENIUS_31 == make_frobenius_table(31));
+  CHECK(FROBENIUS_63 == make_frobenius_table(63));
+}
+
+TEST_CASE("polynomial batch inverse") {
+  std::vector<GCM::Polynomial> a;
+  for (int i = 0; i < 10; ++i) {
+    a.push_back(GCM::Polynomial::random());
+  }
+  a[0] = a[4] = a[9] = GCM::Polynomial::zero();
+  std::vector<GCM::Polynomial> expected;
+  for (const GCM::Polynomial &element : a) {
+    expected.push_back(element.modular_inverse());
+  }
+  GCM::Polynomial::modular_inverse(a, a);
+  CHECK(a == expected);
+}
+
+TEST_CASE("polynomial loops are the same on both backends") {
+  const __m128i exponent = _mm_set_epi64x(0x0123456789abcdef, 0xfedcba98);
+  std::vector<GCM::Polynomial> a;
+  for (int i = 0; i < 10; ++i) {
+    a.push_back(GCM::Polynomial::random());
+  }
+  a[3] = GCM::Polynomial::zero();
+  for (const GCM::Polynomial &x : a) {
+    __m128i portable = pow_portable(x.to_m128i(), exponent);
+    CHECK(GCM::Polynomial(portable) == x.pow(exponent));
+    for (std::size_t k : {0, 5, 8, 9}) {
+      portable = frobenius_portable(x.to_m128i(), k);
+      CHECK(GCM::Polynomial(portable) == x.frobenius(k));
+    }
+    portable = inverse_portable(x.to_m128i());
+    CHECK(GCM::Polynomial(portable) == x.modular_inverse());
+  }
+  std::vector<GCM::Polynomial> expected(a.size(), GCM::Polynomial::zero());
+  GCM::Polynomial::modular_inverse(a, expected);
+  inverse_batch_portable(a, a);
+  CHECK(a == expected);
+}
+
 TEST_CASE("polynomial division") {
   GCM::Polynomial a = GCM::Polynomial(0xfdbadcb514af3c8e, 0x7436ab83ac71aea6);
   GCM::Polynomial b = GCM::Polynomial(0xef7837cbabc961ec, 0x4c151fe393dacc52);
@@ -219,4 +503,152 @@ TEST_CASE("polynomial division") {
   CHECK(b * a_div_b == a);
 }
 
-#endif
\ No newline at end of file
+TEST_CASE("polynomial batch multiplication") {
+  std::vector<GCM::Polynomial> a, b;
+  for (std::size_t i = 0; i < 13; ++i) {
+    a.push_back(GCM::Polynomial::random());
+    b.push_back(GCM::Polynomial::random());
+  }
+
+  std::vector<GCM::Polynomial> products(a.size(), GCM::Polynomial::zero());
+  GCM::Polynomial::multiply(a, b, products);
+  GCM::Polynomial sum = GCM::Polynomial::zero();
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    CHECK(products[i] == a[i] * b[i]);
+    sum += a[i] * b[i];
+  }
+  CHECK(GCM::Polynomial::dot(a, b) == sum);
+  CHECK(GCM::Polynomial::dot({}, {}) == GCM::Polynomial::zero());
+
+  // In place, by a scalar
+  GCM::Polynomial::multiply(a, b[0], a);
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    CHECK(a[i] == products[i] / b[i] * b[0]);
+  }
+}
+
+#endif
+
+#ifdef BENCH
+#include "benchmark.hpp"
+
+BENCHMARK_CASE("gf128 multiplication, 4096 elements") {
+  std::vector<GCM::Polynomial> a, b;
+  for (std::size_t i = 0; i < 4096; ++i) {
+    a.push_back(GCM::Polynomial::random());
+    b.push_back(GCM::Polynomial::random());
+  }
+  std::vector<GCM::Polynomial> out(a.size(), GCM::Polynomial::zero());
+  const std::size_t bytes = a.size() * 16;
+
+  Benchmark::throughput("element-wise multiply", bytes,
+                        [&]() { GCM::Polynomial::multiply(a, b, out); });
+  GCM::Polynomial sum = GCM::Polynomial::zero();
+  Benchmark::throughput("sum of products", bytes, [&]() {
+    for (std::size_t i = 0; i < a.size(); ++i) {
+      sum += a[i] * b[i];
+    }
+  });
+  Benchmark::throughput("dot product", bytes,
+                        [&]() { sum += GCM::Polynomial::dot(a, b); });
+  // Keep the sums alive
+  out[0] += sum;
+}
+
+BENCHMARK_CASE("gf128 conversions, 4096 elements") {
+  std::vector<std::uint8_t> bytes(4096 * 16);
+  for (std::size_t i = 0; i < bytes.size(); i += 16) {
+    GCM::Polynomial::random().to_gcm_bytes(
+        std::span(bytes).subspan(i).first<16>());
+  }
+  std::vector<GCM::Polynomial> out(4096, GCM::Polynomial::zero());
+  std::size_t total = 0;
+
+  Benchmark::throughput("from_gcm_bytes(vector)", bytes.size(), [&]() {
+    for (std::size_t i = 0; i < out.size(); ++i) {
+      out[i] = GCM::Polynomial::from_gcm_bytes(std::vector<std::uint8_t>(
+          bytes.begin() + i * 16, bytes.begin() + i * 16 + 16));
+    }
+  });
+  Benchmark::throughput("from_gcm_bytes(span)", bytes.size(), [&]() {
+    for (std::size_t i = 0; i < out.size(); ++i) {
+      out[i] = GCM::Polynomial::from_gcm_bytes(
+          std::span(bytes).subspan(i * 16).first<16>());
+    }
+  });
+  Benchmark::throughput("to_exponents() -> vector", bytes.size(), [&]() {
+    for (const GCM::Polynomial &x : out) {
+      total += x.to_exponents().size();
+    }
+  });
+  Benchmark::throughput("to_exponents(span)", bytes.size(), [&]() {
+    std::array<std::uint8_t, 128> exponents;
+    for (const GCM::Polynomial &x : out) {
+      total += x.to_exponents(exponents);
+    }
+  });
+  // Keep the counts alive
+  out[0] += GCM::Polynomial(0, total);
+}
+
+BENCHMARK_CASE("gf128 squaring, 4096 elements") {
+  std::vector<GCM::Polynomial> a;
+  for (std::size_t i = 0; i < 4096; ++i) {
+    a.push_back(GCM::Polynomial::random());
+  }
+  std::vector<GCM::Polynomial> out(a.size(), GCM::Polynomial::zero());
+  const std::size_t bytes = a.size() * 16;
+
+  Benchmark::throughput("a * a", bytes, [&]() {
+    for (std::size_t i = 0; i < a.size(); ++i) {
+      out[i] = a[i] * a[i];
+    }
+  });
+  Benchmark::throughput("square", bytes, [&]() {
+    for (std::size_t i = 0; i < a.size(); ++i) {
+      out[i] = a[i].square();
+    }
+  });
+  for (std::size_t k : {8, 9, 63}) {
+    Benchmark::throughput(std::to_string(k) + " squarings", bytes, [&]() {
+      for (std::size_t i = 0; i < a.size(); ++i) {
+        GCM::Polynomial x = a[i];
+        for (std::size_t j = 0; j < k; ++j) {
+          x = x.square();
+        }
+        out[i] = x;
+      }
+    });
+    Benchmark::throughput(std::to_string(k) + " frobenius", bytes, [&]() {
+      for (std::size_t i = 0; i < a.size(); ++i) {
+        out[i] = a[i].frobenius(k);
+      }
+    });
+  }
+}
+
+BENCHMARK_CASE("gf128 inversion, 4096 elements") {
+  std::vector<GCM::Polynomial> a;
+  for (std::size_t i = 0; i < 4096; ++i) {
+    a.push_back(GCM::Polynomial::random());
+  }
+  std::vector<GCM::Polynomial> out(a.size(), GCM::Polynomial::zero());
+  const std::size_t bytes = a.size() * 16;
+  const __m128i order_minus_two =
+      _mm_setr_epi32(0xfffffffe, 0xffffffff, 0xffffffff, 0xffffffff);
+
+  Benchmark::throughput("pow(2^128 - 2)", bytes, [&]() {
+    for (std::size_t i = 0; i < a.size(); ++i) {
+      out[i] = a[i].pow(order_minus_two);
+    }
+  });
+  Benchmark::throughput("Itoh-Tsujii", bytes, [&]() {
+    for (std::size_t i = 0; i < a.size(); ++i) {
+      out[i] = a[i].modular_inverse();
+    }
+  });
+  Benchmark::throughput("batch inverse", bytes, [&]() {
+    GCM::Polynomial::modular_inverse(a, out);
+  });
+}
+#endif
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cppcodec/base64_default_rfc4648.hpp>
 #include <iostream>
@@ -19,9 +20,31 @@ std::vector<std::uint8_t> GCM::Recovery::recover_auth_tag(
 
   std::cerr << "Searching for valid h using msg3 auth tag "
             << cppcodec::base64_rfc4648::encode(msg3.auth_tag) << "\n";
-  while (h_candidates.size() > 0 &&
-         GCM::Recovery::gen_auth_tag(msg1, msg3, h_candidates.back()) !=
-             msg3.auth_tag) {
+  // The GHASHs of msg1 and msg3 under every candidate are independent, so
+  // they are hashed in lockstep
+  std::vector<std::array<std::uint8_t, 16>> keys;
+  keys.reserve(h_candidates.size());
+  for (const GCM::Polynomial &h : h_candidates) {
+    keys.push_back(h.to_gcm_block());
+  }
+  std::vector<GCM::GHASHInput> inputs;
+  inputs.reserve(2 * keys.size());
+  for (const std::array<std::uint8_t, 16> &key : keys) {
+    inputs.push_back({msg1.ciphertext, msg1.associated_data, key});
+    inputs.push_back({msg3.ciphertext, msg3.associated_data, key});
+  }
+  std::vector<std::array<std::uint8_t, 16>> tags = GCM::ghash_multi(inputs);
+  // The tag of msg3 is `ghash(msg3) ^ mask` with `mask = ghash(msg1) ^ tag1`
+  auto valid = [&](std::size_t i) {
+    for (std::size_t j = 0; j < 16; ++j) {
+      if ((tags[2 * i][j] ^ msg1.auth_tag.at(j) ^ tags[2 * i + 1][j]) !=
+          msg3.auth_tag.at(j)) {
+        return false;
+      }
+    }
+    return true;
+  };
+  while (h_candidates.size() > 0 && !valid(h_candidates.size() - 1)) {
     h_candidates.pop_back();
   }
   assert(h_candidates.size() > 0 && "No candidates for H found.");
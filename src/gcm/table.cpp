@@ -0,0 +1,192 @@
+#include <array>
+#include <cstdint>
+#include <emmintrin.h>
+#include <smmintrin.h>
+
+#include "gcm/clmul.hpp"
+#include "gcm/table.hpp"
+
+/// @brief the reduction of the \p BITS lowest bits of an element when it is
+/// multiplied by x^BITS, as the 16 highest bits of the result. Bit j of the
+/// index is the factor of x^(127 - j), which becomes x^(128 + BITS - 1 - j) =
+/// (x^7 + x^2 + x + 1) * x^(BITS - 1 - j); 0xe100 is x^7 + x^2 + x + 1 in the
+/// 16 highest bits.
+template <std::size_t BITS>
+static constexpr std::array<std::uint16_t, 1 << BITS> make_remainders() {
+  std::array<std::uint16_t, 1 << BITS> remainders{};
+  for (std::size_t index = 0; index < remainders.size(); ++index) {
+    for (std::size_t j = 0; j < BITS; ++j) {
+      if (index >> j & 1) {
+        remainders[index] ^= 0xe100 >> (BITS - 1 - j);
+      }
+    }
+  }
+  return remainders;
+}
+
+static constexpr std::array<std::uint16_t, 16> REMAINDERS_4 =
+    make_remainders<4>();
+static constexpr std::array<std::uint16_t, 256> REMAINDERS_8 =
+    make_remainders<8>();
+
+static GCM::Table::Halves split(__m128i x) {
+  return {static_cast<std::uint64_t>(_mm_extract_epi64(x, 1)),
+          static_cast<std::uint64_t>(_mm_cvtsi128_si64(x))};
+}
+
+static __m128i join(GCM::Table::Halves x) {
+  return _mm_set_epi64x(static_cast<long long>(x.high),
+                        static_cast<long long>(x.low));
+}
+
+/// @brief byte \p i of \p x in GCM order, i.e. the factors of x^(8i) to
+/// x^(8i + 7) from the MSB down
+static std::uint8_t byte_at(const GCM::Table::Halves &x, std::size_t i) {
+  return (i < 8 ? x.high : x.low) >> (56 - 8 * (i % 8));
+}
+
+/// @brief multiply \p x by x^1
+static GCM::Table::Halves times_x(GCM::Table::Halves x) {
+  std::uint64_t reduce = x.low & 1 ? 0xe100000000000000 : 0;
+  return {(x.high >> 1) ^ reduce, (x.high << 63) | (x.low >> 1)};
+}
+
+/// @brief fill \p multiples [b] for every b < SIZE, where the MSB of b is the
+/// factor of x^0
+template <std::size_t SIZE>
+static void fill_multiples(GCM::Table::Halves h,
+                           std::array<GCM::Table::Halves, SIZE> &multiples) {
+  multiples[0] = {0, 0};
+  multiples[SIZE / 2] = h;
+  for (std::size_t i = SIZE / 4; i > 0; i /= 2) {
+    multiples[i] = times_x(multiples[2 * i]);
+  }
+  for (std::size_t i = 2; i < SIZE; i *= 2) {
+    for (std::size_t j = 1; j < i; ++j) {
+      multiples[i + j] = {multiples[i].high ^ multiples[j].high,
+                          multiples[i].low ^ multiples[j].low};
+    }
+  }
+}
+
+GCM::Table::Key::Key(__m128i h) { fill_multiples(split(h), m_multiples); }
+
+__m128i GCM::Table::Key::multiply(__m128i x) const {
+  const Halves bytes = split(x);
+  // Horner's rule from the highest byte: z = (z * x^8) + h * byte
+  Halves z = m_multiples[byte_at(bytes, 15)];
+  for (std::size_t i = 15; i-- > 0;) {
+    std::uint8_t remainder = z.low & 0xff;
+    z.low = (z.high << 56) | (z.low >> 8);
+    z.high = (z.high >> 8) ^
+             (static_cast<std::uint64_t>(REMAINDERS_8[remainder]) << 48);
+    const Halves &multiple = m_multiples[byte_at(bytes, i)];
+    z.high ^= multiple.high;
+    z.low ^= multiple.low;
+  }
+  return join(z);
+}
+
+__m128i GCM::Table::multiply(__m128i a, __m128i b) {
+  std::array<Halves, 16> multiples;
+  fill_multiples(split(b), multiples);
+
+  const Halves nibbles = split(a);
+  Halves z = {0, 0};
+  bool first = true;
+  for (std::size_t i = 16; i-- > 0;) {
+    std::uint8_t byte = byte_at(nibbles, i);
+    // The low nibble holds the higher powers of x
+    for (std::uint8_t nibble : {byte & 0xf, byte >> 4}) {
+      if (!first) {
+        std::uint8_t remainder = z.low & 0xf;
+        z.low = (z.high << 60) | (z.low >> 4);
+        z.high = (z.high >> 4) ^
+                 (static_cast<std::uint64_t>(REMAINDERS_4[remainder]) << 48);
+      }
+      first = false;
+      z.high ^= multiples[nibble].high;
+      z.low ^= multiples[nibble].low;
+    }
+  }
+  return join(z);
+}
+
+__m128i GCM::Table::square(__m128i a) { return GCM::Table::multiply(a, a); }
+
+void GCM::Table::multiply_kernel(const __m128i *a, const __m128i *b,
+                                 __m128i *out, std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    out[i] = GCM::Table::multiply(_mm_loadu_si128(&a[i]),
+                                  _mm_loadu_si128(&b[i]));
+  }
+}
+
+void GCM::Table::scale_kernel(const __m128i *a, __m128i scalar, __m128i *out,
+                              std::size_t count) {
+  const GCM::Table::Key key(scalar);
+  for (std::size_t i = 0; i < count; ++i) {
+    out[i] = key.multiply(_mm_loadu_si128(&a[i]));
+  }
+}
+
+__m128i GCM::Table::dot_kernel(const __m128i *a, const __m128i *b,
+                               std::size_t count) {
+  __m128i sum = _mm_setzero_si128();
+  for (std::size_t i = 0; i < count; ++i) {
+    sum = _mm_xor_si128(sum, GCM::Table::multiply(_mm_loadu_si128(&a[i]),
+                                                  _mm_loadu_si128(&b[i])));
+  }
+  return sum;
+}
+
+__m128i GCM::Table::ghash_kernel(__m128i tag, const std::uint8_t *data,
+                                 std::size_t count, const __m128i *powers) {
+  const __m128i reverse =
+      _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+  const GCM::Table::Key key(
+      _mm_loadu_si128(&powers[GCM::CLMUL::GHASH_BLOCKS - 1]));
+  for (std::size_t i = 0; i < count; ++i, data += 16) {
+    __m128i block = _mm_shuffle_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data)), reverse);
+    tag = key.multiply(_mm_xor_si128(tag, block));
+  }
+  return tag;
+}
+
+#ifdef TEST
+#include <random>
+
+#include "doctest.h"
+
+/// @brief the bitwise reference multiplication, Algorithm 1 of NIST SP
+/// 800-38D
+static GCM::Table::Halves reference_multiply(GCM::Table::Halves x,
+                                             GCM::Table::Halves y) {
+  GCM::Table::Halves z = {0, 0};
+  GCM::Table::Halves v = y;
+  for (std::size_t i = 0; i < 128; ++i) {
+    std::uint64_t half = i < 64 ? x.high : x.low;
+    if (half >> (63 - i % 64) & 1) {
+      z.high ^= v.high;
+      z.low ^= v.low;
+    }
+    v = times_x(v);
+  }
+  return z;
+}
+
+TEST_CASE("test table multiplication matches the reference") {
+  std::mt19937_64 gen(16);
+  for (int i = 0; i < 64; ++i) {
+    __m128i a = _mm_set_epi64x(gen(), gen());
+    __m128i b = _mm_set_epi64x(gen(), gen());
+    __m128i expected = join(reference_multiply(split(a), split(b)));
+
+    __m128i diff = _mm_xor_si128(GCM::Table::multiply(a, b), expected);
+    CHECK(_mm_test_all_zeros(diff, diff));
+    diff = _mm_xor_si128(GCM::Table::Key(b).multiply(a), expected);
+    CHECK(_mm_test_all_zeros(diff, diff));
+  }
+}
+#endif
@@ -1,16 +1,20 @@
 #include <algorithm>
 #include <cstdint>
 #include <nlohmann/json.hpp>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
 #include "cppcodec/base64_rfc4648.hpp"
 #include "glue.hpp"
+#include "random.hpp"
 
 using json = nlohmann::json;
 
 /// @brief executes a specific action by parsing the arguments from the JSON and
-/// calling the correct library function
+/// calling the correct library function. If the input contains an unsigned
+/// integer "seed", the random generators are seeded with it first, which makes
+/// randomized actions such as Cantor-Zassenhaus reproducible.
 /// @param input The labwork-docker JSON specification
 /// @return the JSON resulting from the action
 /// @throws std::out_of_range if the given action is not known
@@ -23,5 +27,11 @@ json Glue::execute_action(const json &input) {
   } catch (const std::out_of_range &ex) {
     throw std::out_of_range("Unknown action");
   }
+  if (input.contains("seed")) {
+    if (!input["seed"].is_number_unsigned()) {
+      throw std::runtime_error("'seed' must be an unsigned integer");
+    }
+    Random::seed(input["seed"].get<std::uint64_t>());
+  }
   return func(input);
 }
\ No newline at end of file
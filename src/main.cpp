@@ -29,12 +29,18 @@
 #include "doctest.h"
 #endif
 
+#ifdef BENCH
+#include "benchmark.hpp"
+#endif
+
 #include "glue.hpp"
 #include "main.hpp"
 
 using json = nlohmann::json;
 
-#ifndef TEST
+#ifdef BENCH
+int main() { return Benchmark::run_all(); }
+#elif !defined(TEST)
 int main(int argc, char *argv[]) {
   // 1. Parse the data
   json input;
@@ -0,0 +1,72 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "parallel.hpp"
+
+std::size_t Parallel::default_threads() {
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void Parallel::for_each_index(std::size_t count,
+                              const std::function<void(std::size_t)> &task,
+                              std::size_t threads) {
+  threads = std::clamp<std::size_t>(threads, 1, std::max<std::size_t>(count, 1));
+  std::atomic<std::size_t> next = 0;
+  std::exception_ptr error = nullptr;
+  std::mutex error_mutex;
+
+  auto worker = [&]() {
+    for (std::size_t i = next++; i < count; i = next++) {
+      try {
+        task(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+    }
+  };
+
+  {
+    // The calling thread is one of the workers.
+    std::vector<std::jthread> pool;
+    for (std::size_t i = 1; i < threads; ++i) {
+      pool.emplace_back(worker);
+    }
+    worker();
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+#ifdef TEST
+#include "doctest.h"
+
+TEST_CASE("test parallel for_each_index visits every index once") {
+  std::vector<std::atomic<int>> visits(1000);
+  Parallel::for_each_index(
+      visits.size(), [&](std::size_t i) { ++visits[i]; }, 4);
+  CHECK(std::all_of(visits.begin(), visits.end(),
+                    [](const std::atomic<int> &v) { return v == 1; }));
+}
+
+TEST_CASE("test parallel for_each_index propagates exceptions") {
+  CHECK_THROWS_AS(Parallel::for_each_index(
+                      10,
+                      [](std::size_t i) {
+                        if (i == 7)
+                          throw std::runtime_error("task failed");
+                      },
+                      3),
+                  std::runtime_error);
+}
+#endif
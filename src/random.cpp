@@ -0,0 +1,128 @@
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <random>
+
+#include "random.hpp"
+
+Random::Xoshiro256::Xoshiro256(std::uint64_t seed) {
+  for (std::uint64_t &word : m_state) {
+    // SplitMix64
+    std::uint64_t z = (seed += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    word = z ^ (z >> 31);
+  }
+}
+
+void Random::Xoshiro256::jump() {
+  static constexpr std::array<std::uint64_t, 4> JUMP = {
+      0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa,
+      0x39abdc4529b1661c};
+  std::array<std::uint64_t, 4> state{};
+  for (std::uint64_t jump : JUMP) {
+    for (int bit = 0; bit < 64; ++bit) {
+      if (jump >> bit & 1) {
+        for (std::size_t i = 0; i < state.size(); ++i) {
+          state[i] ^= m_state[i];
+        }
+      }
+      (*this)();
+    }
+  }
+  m_state = state;
+}
+
+namespace {
+/// @brief guards the fields below
+std::mutex seed_mutex;
+bool seeded = false;
+std::uint64_t base_seed;
+/// @brief the stream index of the next thread to call Random::generator()
+std::uint64_t next_stream = 0;
+
+/// @brief incremented by every call to Random::seed(), so that threads notice
+/// when their generator is stale
+std::atomic<std::uint64_t> generation = 1;
+
+struct ThreadGenerator {
+  Random::Xoshiro256 generator{0};
+  /// @brief the generation this generator was derived in, 0 if never
+  std::uint64_t generation = 0;
+};
+thread_local ThreadGenerator thread_generator;
+
+/// @brief derive the generator for the next stream. seed_mutex must be held.
+Random::Xoshiro256 next_generator() {
+  if (!seeded) {
+    std::random_device rd;
+    base_seed = static_cast<std::uint64_t>(rd()) << 32 | rd();
+    seeded = true;
+  }
+  Random::Xoshiro256 generator(base_seed);
+  for (std::uint64_t i = 0; i < next_stream; ++i) {
+    generator.jump();
+  }
+  ++next_stream;
+  return generator;
+}
+} // namespace
+
+void Random::seed(std::uint64_t seed) {
+  std::lock_guard<std::mutex> lock(seed_mutex);
+  base_seed = seed;
+  seeded = true;
+  next_stream = 0;
+  thread_generator.generator = next_generator();
+  thread_generator.generation = ++generation;
+}
+
+Random::Xoshiro256 &Random::generator() {
+  if (thread_generator.generation != generation.load()) {
+    std::lock_guard<std::mutex> lock(seed_mutex);
+    thread_generator.generator = next_generator();
+    thread_generator.generation = generation.load();
+  }
+  return thread_generator.generator;
+}
+
+#ifdef TEST
+#include <thread>
+#include <vector>
+
+#include "doctest.h"
+
+TEST_CASE("test xoshiro256** reference output") {
+  // The first outputs of the reference implementation for this state
+  Random::Xoshiro256 generator({1, 2, 3, 4});
+  CHECK(generator() == 11520);
+  CHECK(generator() == 0);
+  CHECK(generator() == 1509978240);
+  CHECK(generator() == 1215971899390074240);
+}
+
+TEST_CASE("test seeded generators are reproducible per thread") {
+  auto draw = []() {
+    std::array<std::uint64_t, 8> words;
+    Random::generator().fill(words);
+    return words;
+  };
+  Random::seed(17);
+  auto first = draw();
+  Random::seed(17);
+  CHECK(draw() == first);
+
+  // Another thread gets the next, jumped stream
+  Random::seed(17);
+  draw();
+  std::array<std::uint64_t, 8> other;
+  std::thread([&]() { other = draw(); }).join();
+  Random::Xoshiro256 expected(17);
+  expected.jump();
+  std::array<std::uint64_t, 8> jumped;
+  expected.fill(jumped);
+  CHECK(other == jumped);
+  CHECK(other != first);
+}
+#endif
@@ -0,0 +1,73 @@
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "stream.hpp"
+
+std::uint64_t Stream::transform(std::istream &input, std::ostream &output,
+                                const chunk_transform &transform) {
+  auto in = std::vector<std::uint8_t>(CHUNK_SIZE);
+  auto out = std::vector<std::uint8_t>(CHUNK_SIZE);
+  std::uint64_t total = 0;
+  while (input) {
+    input.read(reinterpret_cast<char *>(in.data()), in.size());
+    std::size_t size = input.gcount();
+    if (input.bad()) {
+      throw std::runtime_error("Failed to read the input stream");
+    }
+    transform(std::span(in).first(size), std::span(out).first(size));
+    output.write(reinterpret_cast<const char *>(out.data()), size);
+    if (!output) {
+      throw std::runtime_error("Failed to write the output stream");
+    }
+    total += size;
+  }
+  return total;
+}
+
+#ifdef TEST
+#include <sstream>
+#include <string>
+
+#include "doctest.h"
+
+TEST_CASE("test stream transform processes every chunk in order") {
+  auto data = std::string(2 * Stream::CHUNK_SIZE + 1000, '\0');
+  for (std::size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<char>(i ^ (i >> 13));
+  }
+  std::istringstream input(data);
+  std::ostringstream output;
+  std::vector<std::size_t> sizes;
+  auto processed = Stream::transform(
+      input, output,
+      [&](std::span<const std::uint8_t> in, std::span<std::uint8_t> out) {
+        sizes.push_back(in.size());
+        for (std::size_t i = 0; i < in.size(); ++i) {
+          out[i] = ~in[i];
+        }
+      });
+  CHECK(processed == data.size());
+  CHECK(sizes.front() == Stream::CHUNK_SIZE);
+  CHECK(sizes.back() <= Stream::CHUNK_SIZE);
+
+  std::string expected = data;
+  for (char &byte : expected) {
+    byte = static_cast<char>(~byte);
+  }
+  CHECK(output.str() == expected);
+}
+
+TEST_CASE("test stream transform reports write failures") {
+  std::istringstream input("abc");
+  std::ostringstream output;
+  output.setstate(std::ios::badbit);
+  CHECK_THROWS_AS(Stream::transform(input, output,
+                                    [](std::span<const std::uint8_t>,
+                                       std::span<std::uint8_t>) {}),
+                  std::runtime_error);
+}
+#endif